@@ -104,11 +104,26 @@ const int c_attr_TexCoord0 = 1;
 const int c_attr_Tangent = 3;
 const int c_attr_Binormal = 4;
 
+/// \brief A flat convex polygon in client memory, described so that the renderer can merge it with others into one draw call.
+struct OpenGLPolygon
+{
+	const float* vertices;  ///< xyz positions, \c stride bytes apart
+	const float* texcoords; ///< st texture coordinates, \c stride bytes apart
+	unsigned int stride;
+	unsigned int count;
+	float normal[3];
+};
+
 class OpenGLRenderable
 {
 public:
 virtual ~OpenGLRenderable() = default;
 virtual void render( RenderStateFlags state ) const = 0;
+/// \brief Returns true and fills \p polygon if this renderable draws exactly one flat polygon that may be batched with others.
+/// Only used for states without per-vertex tangent data; \c render is called otherwise.
+virtual bool getPolygon( OpenGLPolygon& polygon ) const {
+	return false;
+}
 };
 
 class Matrix4;
@@ -30,6 +30,7 @@ template<typename value_type>
 class Stack;
 template<typename Contained>
 class Reference;
+class VolumeTest;
 
 namespace scene
 {
@@ -94,6 +95,9 @@ virtual void erase_root() = 0;
 virtual void traverse( const Walker& walker ) = 0;
 /// \brief Traverses all nodes in the graph depth-first, starting from 'start'.
 virtual void traverse_subgraph( const Walker& walker, const Path& start ) = 0;
+/// \brief Traverses the nodes in the graph depth-first from the root node, skipping instances whose world bounds are entirely outside 'volume'.
+/// Instances are visited in the same order as by \c traverse, each one after all of its ancestors.
+virtual void traverse_visible( const Walker& walker, const VolumeTest& volume ) = 0;
 /// \brief Returns the instance at the location identified by 'path', or 0 if it does not exist.
 virtual scene::Instance* find( const Path& path ) = 0;
 
@@ -104,6 +108,12 @@ virtual void sceneChanged() = 0;
 /// \todo Move to a separate class.
 virtual void addSceneChangedCallback( const SignalHandler& handler ) = 0;
 
+/// \brief Holds back scene-changed and bounds-changed callbacks until the matching \c endChanges.
+/// Pairs may nest. Each held-back signal is invoked once when the outermost pair ends.
+virtual void beginChanges() = 0;
+/// \brief Ends a \c beginChanges pair.
+virtual void endChanges() = 0;
+
 /// \brief Invokes all bounds-changed callbacks. Called when the bounds of any instance in the scene change.
 /// \todo Move to a separate class.
 virtual void boundsChanged() = 0;
@@ -111,6 +121,8 @@ virtual void boundsChanged() = 0;
 virtual SignalHandlerId addBoundsChangedCallback( const SignalHandler& boundsChanged ) = 0;
 /// \brief Remove a \p callback to be invoked when the bounds of any instance in the scene change.
 virtual void removeBoundsChangedCallback( SignalHandlerId id ) = 0;
+/// \brief Called when the world bounds of \p instance may have changed.
+virtual void instanceBoundsChanged( Instance& instance ) = 0;
 
 virtual TypeId getNodeTypeId( const char* name ) = 0;
 virtual TypeId getInstanceTypeId( const char* name ) = 0;
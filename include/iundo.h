@@ -33,10 +33,24 @@ class UndoMemento
 {
 public:
 virtual void release() = 0;
+/// \brief Returns an estimate of the memory owned by this memento in bytes, or 0 if unknown. Used to bound the size of the undo history.
+virtual std::size_t memorySize() const {
+	return 0;
+}
 virtual ~UndoMemento() {
 }
 };
 
+/// \brief Implemented by scene nodes that can estimate the memory they own.
+/// Used to account for deleted nodes that are kept alive only by the undo history.
+class UndoMemorySize
+{
+public:
+STRING_CONSTANT( Name, "UndoMemorySize" );
+
+virtual std::size_t memorySize() const = 0;
+};
+
 class Undoable
 {
 public:
@@ -69,6 +69,11 @@ virtual DebugMessageHandler& getDebugMessageHandler() = 0;
 virtual void registerModule( const char* type, int version, const char* name, Module& module ) = 0;
 virtual Module* findModule( const char* type, int version, const char* name ) const = 0;
 virtual void foreachModule( const char* type, int version, const Visitor& visitor ) = 0;
+
+/// \brief Opens a span named \p name in the startup trace. Spans nest, and are only recorded on the main thread.
+virtual void beginTrace( const char* category, const char* name ) = 0;
+/// \brief Closes the most recently opened span.
+virtual void endTrace() = 0;
 };
 
 class ModuleServerHolder
@@ -93,6 +98,20 @@ inline ModuleServer& globalModuleServer(){
 }
 
 
+/// \brief Records the time spent in the enclosing scope as a span in the startup trace.
+class ModuleTraceScope
+{
+ModuleServer& m_server;
+public:
+ModuleTraceScope( const char* category, const char* name, ModuleServer& server = globalModuleServer() ) : m_server( server ){
+	m_server.beginTrace( category, name );
+}
+~ModuleTraceScope(){
+	m_server.endTrace();
+}
+};
+
+
 inline void initialiseModule( ModuleServer& server ){
 	GlobalErrorStream::instance().setOutputStream( server.getErrorStream() );
 	GlobalOutputStream::instance().setOutputStream( server.getOutputStream() );
@@ -323,6 +323,9 @@ void DecRef(){
 		delete this;
 	}
 }
+std::size_t getReferenceCount() const {
+	return m_refcount;
+}
 
 void instanceAttach( MapFile* map ){
 	m_undo.instanceAttach( map );
@@ -369,6 +372,26 @@ void importState( const CopiedString& string ){
 typedef MemberCaller<KeyValue, void(const CopiedString&), &KeyValue::importState> UndoImportCaller;
 };
 
+inline std::size_t undo_memorySize( const CopiedString& string ){
+	return string_length( string.c_str() ) + 1;
+}
+
+/// \brief Returns the heap memory held by a copy of an entity's keys saved for undo.
+/// Values held by nothing but the copy are those of keys since removed, so they are counted as owned.
+template<typename Key>
+inline std::size_t undo_memorySize( const UnsortedMap<Key, SmartPointer<KeyValue> >& values ){
+	std::size_t size = 0;
+	for ( typename UnsortedMap<Key, SmartPointer<KeyValue> >::const_iterator i = values.begin(); i != values.end(); ++i )
+	{
+		// list node: two links plus the key and value references
+		size += sizeof( *i ) + 2 * sizeof( void* );
+		if ( ( *i ).second->getReferenceCount() == 1 ) {
+			size += sizeof( KeyValue ) + string_length( ( *i ).second->c_str() ) + 1;
+		}
+	}
+	return size;
+}
+
 /// \brief An unsorted list of key/value pairs.
 ///
 /// - Notifies observers when a pair is inserted or removed.
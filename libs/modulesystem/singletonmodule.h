@@ -101,6 +101,7 @@ void* getTable(){
 }
 void capture(){
 	if ( ++m_refcount == 1 ) {
+		ModuleTraceScope trace( typename Type::Name(), APIConstructor::getName() );
 		globalOutputStream() << "Module Initialising: '" << typename Type::Name() << "' '" << APIConstructor::getName() << "'\n";
 		m_dependencies = new Dependencies();
 		m_dependencyCheck = !globalModuleServer().getError();
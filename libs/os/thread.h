@@ -0,0 +1,84 @@
+/*
+   This file is part of GtkRadiant.
+
+   GtkRadiant is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   GtkRadiant is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GtkRadiant; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#if !defined( INCLUDED_OS_THREAD_H )
+#define INCLUDED_OS_THREAD_H
+
+/// \file
+/// \brief Runs a batch of independent jobs on a temporary set of worker threads.
+
+#include <glib.h>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+
+template<typename Job>
+class ThreadJobs
+{
+Job& m_job;
+const std::size_t m_count;
+gint m_next;
+
+static gpointer run_thread( gpointer data ){
+	reinterpret_cast<ThreadJobs*>( data )->run();
+	return 0;
+}
+public:
+ThreadJobs( Job& job, std::size_t count ) : m_job( job ), m_count( count ), m_next( 0 ){
+}
+
+/// \brief Runs jobs until none are left. Each index is claimed by exactly one caller.
+void run(){
+	for (;; )
+	{
+		const std::size_t i = g_atomic_int_add( &m_next, 1 );
+		if ( i >= m_count ) {
+			return;
+		}
+		m_job( i );
+	}
+}
+
+/// \brief Runs all jobs on the calling thread and \p threads - 1 workers, returning once all are done.
+void run( std::size_t threads, const char* name ){
+	std::vector<GThread*> workers;
+	for ( std::size_t i = 1; i < threads; ++i )
+	{
+		workers.push_back( g_thread_new( name, run_thread, this ) );
+	}
+	run();
+	for ( std::vector<GThread*>::iterator i = workers.begin(); i != workers.end(); ++i )
+	{
+		g_thread_join( *i );
+	}
+}
+};
+
+/// \brief The number of threads worth running \p count jobs on, giving each at least \p minJobsPerThread.
+inline std::size_t thread_count_for_jobs( std::size_t count, std::size_t minJobsPerThread ){
+	return std::max( std::min( std::size_t( g_get_num_processors() ), count / minJobsPerThread ), std::size_t( 1 ) );
+}
+
+/// \brief Calls \p job( i ) for each i in [0, \p count), on as many threads as thread_count_for_jobs allows.
+/// Jobs may run in any order and concurrently; all have finished when this returns.
+template<typename Job>
+inline void thread_run_jobs( std::size_t count, std::size_t minJobsPerThread, const char* name, Job job ){
+	ThreadJobs<Job>( job, count ).run( thread_count_for_jobs( count, minJobsPerThread ), name );
+}
+
+#endif
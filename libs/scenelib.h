@@ -669,6 +669,7 @@ void transformChangedLocal(){
 	m_boundsChanged = true;
 	m_childBoundsChanged = true;
 	m_transformChangedCallback();
+	GlobalSceneGraph().instanceBoundsChanged( *this );
 }
 void transformChanged(){
 	GlobalSceneGraph().traverse_subgraph( TransformChangedWalker(), m_path );
@@ -693,6 +694,7 @@ void boundsChanged(){
 	if ( m_parent != 0 ) {
 		m_parent->boundsChanged();
 	}
+	GlobalSceneGraph().instanceBoundsChanged( *this );
 	GlobalSceneGraph().boundsChanged();
 }
 
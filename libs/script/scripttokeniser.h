@@ -22,6 +22,7 @@
 #if !defined( INCLUDED_SCRIPT_SCRIPTTOKENISER_H )
 #define INCLUDED_SCRIPT_SCRIPTTOKENISER_H
 
+#include <cstring>
 #include "iscriplib.h"
 
 class ScriptTokeniser : public Tokeniser
@@ -39,16 +40,20 @@ enum CharType
 
 typedef bool ( ScriptTokeniser::*Tokenise )( char c );
 
+enum unnamed0 { m_bufsize = 16384 };
+
 Tokenise m_stack[3];
 Tokenise* m_state;
-SingleCharacterInputStream<TextInputStream> m_istream;
+TextInputStream& m_istream;
+char m_buffer[m_bufsize];
+const char* m_cur;
+const char* m_end;
 std::size_t m_scriptline;
 std::size_t m_scriptcolumn;
 
 char m_token[MAXTOKEN];
 char* m_write;
 
-char m_current;
 bool m_eof;
 bool m_crossline;
 bool m_unget;
@@ -88,6 +93,14 @@ void add( const char c ){
 		*m_write++ = c;
 	}
 }
+void add( const char* first, std::size_t count ){
+	const std::size_t room = m_token + MAXTOKEN - 1 - m_write;
+	if ( count > room ) {
+		count = room;
+	}
+	std::memcpy( m_write, first, count );
+	m_write += count;
+}
 void remove(){
 	ASSERT_MESSAGE( m_write > m_token, "no char to remove" );
 	--m_write;
@@ -247,13 +260,98 @@ bool tokeniseSpecial( char c ){
 	return true;
 }
 
+bool fillBuffer(){
+	m_end = m_buffer + m_istream.read( m_buffer, m_bufsize );
+	m_cur = m_buffer;
+	return m_cur != m_end;
+}
+bool isTokenChar( const char c ){
+	return c > 32 && c != '"' && ( !m_special || charType( c ) != eCharSpecial );
+}
+void advance( const char c ){
+	if ( c == '\n' ) {
+		++m_scriptline;
+		m_scriptcolumn = 1;
+	}
+	else
+	{
+		++m_scriptcolumn;
+	}
+}
+
+/// Consumes the buffered characters that leave the current state unchanged, without dispatching them one at a time.
+void scanRun(){
+	const char* first = m_cur;
+	const char* p = first;
+	const Tokenise current = state();
+	if ( current == Tokenise( &ScriptTokeniser::tokeniseToken ) ) {
+		while ( p != m_end && isTokenChar( *p ) )
+		{
+			++p;
+		}
+		add( first, p - first );
+	}
+	else if ( current == Tokenise( &ScriptTokeniser::tokeniseQuotedToken ) ) {
+		while ( p != m_end && *p != '"' && *p != '\n' )
+		{
+			++p;
+		}
+		add( first, p - first );
+	}
+	else if ( current == Tokenise( &ScriptTokeniser::tokeniseComment ) ) {
+		p = static_cast<const char*>( std::memchr( first, '\n', m_end - first ) );
+		if ( p == 0 ) {
+			p = m_end;
+		}
+	}
+	else
+	{
+		if ( current == Tokenise( &ScriptTokeniser::tokeniseBlockComment ) ) {
+			for ( ; p != m_end && *p != '*'; ++p )
+			{
+				advance( *p );
+			}
+		}
+		else if ( current == Tokenise( &ScriptTokeniser::tokeniseDefault ) && m_crossline ) {
+			for ( ; p != m_end && !( *p > 32 ); ++p )
+			{
+				advance( *p );
+			}
+			if ( p != m_end && *p != '/' && isTokenChar( *p ) ) {
+				// the first character of an unquoted token, as tokeniseDefault would push it
+				push( Tokenise( &ScriptTokeniser::tokeniseToken ) );
+				first = p;
+				while ( ++p != m_end && isTokenChar( *p ) )
+				{
+				}
+				add( first, p - first );
+				m_scriptcolumn += p - first;
+			}
+		}
+		m_cur = p;
+		return;
+	}
+	// the run contains no line breaks
+	m_scriptcolumn += p - first;
+	m_cur = p;
+}
+
 /// Returns true if a token was successfully parsed.
 bool tokenise(){
 	m_write = m_token;
-	while ( !eof() )
+	while ( !m_eof )
 	{
-		char c = m_current;
+		if ( m_cur == m_end && !fillBuffer() ) {
+			m_eof = true;
+			break;
+		}
 
+		scanRun();
+		if ( m_cur == m_end ) {
+			continue;
+		}
+
+		const char c = *m_cur;
 		if ( !( ( *this ).*state() )( c ) ) {
 			// parse error
 			m_eof = true;
@@ -264,16 +362,8 @@ bool tokenise(){
 			return true;
 		}
 
-		if ( c == '\n' ) {
-			++m_scriptline;
-			m_scriptcolumn = 1;
-		}
-		else
-		{
-			++m_scriptcolumn;
-		}
-
-		m_eof = !m_istream.readChar( m_current );
+		advance( c );
+		++m_cur;
 	}
 	return m_write != m_token;
 }
@@ -287,22 +377,21 @@ const char* fillToken(){
 	return m_token;
 }
 
-bool eof(){
-	return m_eof;
-}
-
 public:
-ScriptTokeniser( TextInputStream& istream, bool special )
+/// \p line is the line number of the first character in \p istream, for streams that start part-way through a script.
+ScriptTokeniser( TextInputStream& istream, bool special, std::size_t line = 1 )
 	: m_state( m_stack ),
 	m_istream( istream ),
-	m_scriptline( 1 ),
+	m_cur( m_buffer ),
+	m_end( m_buffer ),
+	m_scriptline( line ),
 	m_scriptcolumn( 1 ),
+	m_eof( false ),
 	m_crossline( false ),
 	m_unget( false ),
 	m_emit( false ),
 	m_special( special ){
 	m_stack[0] = Tokenise( &ScriptTokeniser::tokeniseDefault );
-	m_eof = !m_istream.readChar( m_current );
 	m_token[MAXTOKEN - 1] = '\0';
 }
 void release(){
@@ -99,6 +99,48 @@ inline void nodeset_diff( const UnsortedNodeSet& self, const UnsortedNodeSet& ot
 	std::set_difference( other_sorted.begin(), other_sorted.end(), sorted.begin(), sorted.end(), TraversableObserverInsertOutputIterator( observer ) );
 }
 
+class InstanceCountVisitor : public scene::Instantiable::Visitor
+{
+std::size_t& m_count;
+public:
+InstanceCountVisitor( std::size_t& count ) : m_count( count ){
+}
+void visit( scene::Instance& instance ) const {
+	++m_count;
+}
+};
+
+inline bool Node_isInstanced( scene::Node& node ){
+	std::size_t count = 0;
+	scene::Instantiable* instantiable = Node_getInstantiable( node );
+	if ( instantiable != 0 ) {
+		instantiable->forEachInstance( InstanceCountVisitor( count ) );
+	}
+	return count != 0;
+}
+
+class MemorySizeWalker : public scene::Traversable::Walker
+{
+std::size_t& m_size;
+public:
+MemorySizeWalker( std::size_t& size ) : m_size( size ){
+}
+bool pre( scene::Node& node ) const {
+	UndoMemorySize* memorySize = NodeTypeCast<UndoMemorySize>::cast( node );
+	if ( memorySize != 0 ) {
+		m_size += memorySize->memorySize();
+	}
+	return true;
+}
+};
+
+/// \brief Returns the memory owned by the subgraph rooted at \p node, as far as its nodes implement UndoMemorySize.
+inline std::size_t Node_subgraphMemorySize( scene::Node& node ){
+	std::size_t size = 0;
+	Node_traverseSubgraph( node, MemorySizeWalker( size ) );
+	return size;
+}
+
 /// \brief A sequence of node references which notifies an observer of inserts and deletions, and uses the global undo system to provide undo for modifications.
 class TraversableNodeSet : public scene::Traversable
 {
@@ -204,6 +246,22 @@ bool empty() const {
 	return m_children.empty();
 }
 
+/// \brief Returns the heap memory held by a copy of this set saved for undo.
+/// Children that are no longer in the scene are kept alive only by the copy, so their whole subgraph is counted.
+std::size_t memorySize() const {
+	std::size_t size = 0;
+	for ( UnsortedNodeSet::const_iterator i = m_children.begin(); i != m_children.end(); ++i )
+	{
+		// list node: two links plus the reference
+		size += sizeof( NodeSmartReference ) + 2 * sizeof( void* );
+		scene::Node& node = ( *i ).get();
+		if ( !Node_isInstanced( node ) ) {
+			size += Node_subgraphMemorySize( node );
+		}
+	}
+	return size;
+}
+
 void instanceAttach( MapFile* map ){
 	m_undo.instanceAttach( map );
 }
@@ -221,6 +279,10 @@ inline void swap( TraversableNodeSet& self, TraversableNodeSet& other ){
 }
 }
 
+inline std::size_t undo_memorySize( const TraversableNodeSet& nodes ){
+	return nodes.memorySize();
+}
+
 
 class TraversableNode : public scene::Traversable
 {
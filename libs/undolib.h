@@ -27,6 +27,13 @@
 #include "warnings.h"
 #include "generic/callback.h"
 
+/// \brief Returns the heap memory owned by \p data in bytes, beyond sizeof( data ).
+/// Overloaded for each type saved in a BasicUndoMemento that owns heap storage; the overload is found by argument-dependent lookup.
+template<typename Copyable>
+inline std::size_t undo_memorySize( const Copyable& data ){
+	return 0;
+}
+
 template<typename Copyable>
 class BasicUndoMemento : public UndoMemento
 {
@@ -40,6 +47,10 @@ void release(){
 	delete this;
 }
 
+std::size_t memorySize() const {
+	return sizeof( *this ) + undo_memorySize( m_data );
+}
+
 const Copyable& get() const {
 	return m_data;
 }
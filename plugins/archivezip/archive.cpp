@@ -27,53 +27,95 @@
 #include "iarchive.h"
 
 #include <algorithm>
+#include <cstring>
+#include <list>
+#include <map>
 #include "stream/filestream.h"
 #include "container/array.h"
+#include "generic/referencecounted.h"
 #include "archivelib.h"
-#include "zlibstream.h"
+#include "zlib.h"
 
-class DeflatedArchiveFile : public ArchiveFile
+/// \brief The uncompressed contents of a zip entry, shared between the inflate cache and the files opened from it.
+class ZipEntryData
 {
-CopiedString m_name;
-FileInputStream m_istream;
-SubFileInputStream m_substream;
-DeflatedInputStream m_zipstream;
-FileInputStream::size_type m_size;
+std::size_t m_refcount;
+Array<unsigned char> m_data;
+public:
+ZipEntryData( std::size_t size ) : m_refcount( 0 ), m_data( size ){
+}
+void IncRef(){
+	++m_refcount;
+}
+void DecRef(){
+	if ( --m_refcount == 0 ) {
+		delete this;
+	}
+}
+unsigned char* data(){
+	return m_data.data();
+}
+const unsigned char* data() const {
+	return m_data.data();
+}
+std::size_t size() const {
+	return m_data.size();
+}
+};
+
+typedef SmartPointer<ZipEntryData> ZipEntryDataPointer;
+
+class ZipEntryInputStream : public InputStream
+{
+ZipEntryDataPointer m_data;
+std::size_t m_position;
 public:
-typedef FileInputStream::size_type size_type;
-typedef FileInputStream::position_type position_type;
+ZipEntryInputStream( ZipEntryData* data ) : m_data( data ), m_position( 0 ){
+}
+size_type read( byte_type* buffer, size_type length ){
+	const std::size_t count = std::min( std::size_t( length ), m_data->size() - m_position );
+	if ( count != 0 ) {
+		std::memcpy( buffer, m_data->data() + m_position, count );
+		m_position += count;
+	}
+	return count;
+}
+std::size_t size() const {
+	return m_data->size();
+}
+};
 
-DeflatedArchiveFile( const char* name, const char* archiveName, position_type position, size_type stream_size, size_type file_size )
-	: m_name( name ), m_istream( archiveName ), m_substream( m_istream, position, stream_size ), m_zipstream( m_substream ), m_size( file_size ){
+class ZipEntryArchiveFile : public ArchiveFile
+{
+CopiedString m_name;
+ZipEntryInputStream m_istream;
+public:
+ZipEntryArchiveFile( const char* name, ZipEntryData* data )
+	: m_name( name ), m_istream( data ){
 }
 
 void release(){
 	delete this;
 }
-size_type size() const {
-	return m_size;
+std::size_t size() const {
+	return m_istream.size();
 }
 const char* getName() const {
 	return m_name.c_str();
 }
 InputStream& getInputStream(){
-	return m_zipstream;
+	return m_istream;
 }
 };
 
-class DeflatedArchiveTextFile : public ArchiveTextFile
+class ZipEntryArchiveTextFile : public ArchiveTextFile
 {
 CopiedString m_name;
-FileInputStream m_istream;
-SubFileInputStream m_substream;
-DeflatedInputStream m_zipstream;
-BinaryToTextInputStream<DeflatedInputStream> m_textStream;
+ZipEntryInputStream m_istream;
+BinaryToTextInputStream<ZipEntryInputStream> m_textStream;
 public:
-typedef FileInputStream::size_type size_type;
-typedef FileInputStream::position_type position_type;
-
-DeflatedArchiveTextFile( const char* name, const char* archiveName, position_type position, size_type stream_size )
-	: m_name( name ), m_istream( archiveName ), m_substream( m_istream, position, stream_size ), m_zipstream( m_substream ), m_textStream( m_zipstream ){
+ZipEntryArchiveTextFile( const char* name, ZipEntryData* data )
+	: m_name( name ), m_istream( data ), m_textStream( m_istream ){
 }
 
 void release(){
@@ -84,6 +126,63 @@ TextInputStream& getInputStream(){
 }
 };
 
+/// \brief A least-recently-used cache of zip entry contents, shared by all open archives and bounded by the total size of the cached data.
+/// Shaders and textures are re-read many times when the shader system or the texture browser is refreshed.
+class ZipEntryCache
+{
+typedef std::pair<const void*, const void*> Key; // archive, record
+typedef std::list< std::pair<Key, ZipEntryDataPointer> > Entries;
+typedef std::map<Key, Entries::iterator> Index;
+
+Entries m_entries; // most recently used first
+Index m_index;
+std::size_t m_size;
+std::size_t m_budget;
+
+void pop_back(){
+	m_size -= m_entries.back().second->size();
+	m_index.erase( m_entries.back().first );
+	m_entries.pop_back();
+}
+public:
+ZipEntryCache( std::size_t budget ) : m_size( 0 ), m_budget( budget ){
+}
+
+ZipEntryData* find( const void* archive, const void* record ){
+	Index::iterator i = m_index.find( Key( archive, record ) );
+	if ( i == m_index.end() ) {
+		return 0;
+	}
+	m_entries.splice( m_entries.begin(), m_entries, ( *i ).second );
+	return m_entries.front().second.get();
+}
+void insert( const void* archive, const void* record, ZipEntryData* data ){
+	// a single large entry would flush everything else
+	if ( data->size() > m_budget / 4 ) {
+		return;
+	}
+	m_entries.push_front( Entries::value_type( Key( archive, record ), ZipEntryDataPointer( data ) ) );
+	m_index.insert( Index::value_type( Key( archive, record ), m_entries.begin() ) );
+	m_size += data->size();
+	while ( m_size > m_budget )
+	{
+		pop_back();
+	}
+}
+/// \brief Drops all entries of \p archive. Must be called before the archive is destroyed, as its records may be reused.
+void erase( const void* archive ){
+	Index::iterator i = m_index.lower_bound( Key( archive, 0 ) );
+	while ( i != m_index.end() && ( *i ).first.first == archive )
+	{
+		m_size -= ( *( *i ).second ).second->size();
+		m_entries.erase( ( *i ).second );
+		m_index.erase( i++ );
+	}
+}
+};
+
+ZipEntryCache g_zipEntryCache( 32 << 20 );
+
 #include "pkzip.h"
 
 #include <map>
@@ -193,6 +292,69 @@ bool read_pkzip(){
 	}
 	return false;
 }
+
+/// \brief Returns the contents of \p file, read through the archive's own stream, or 0 on error.
+ZipEntryData* readFile( ZipRecord* file ){
+	ZipEntryData* cached = g_zipEntryCache.find( this, file );
+	if ( cached != 0 ) {
+		return cached;
+	}
+
+	m_istream.seek( file->m_position );
+	zip_file_header file_header;
+	istream_read_zip_file_header( m_istream, file_header );
+	if ( file_header.z_magic != zip_file_header_magic ) {
+		globalErrorStream() << "error reading zip file " << makeQuoted( m_name.c_str() ) << '\n';
+		return 0;
+	}
+
+	ZipEntryData* data = new ZipEntryData( file->m_file_size );
+	switch ( file->m_mode )
+	{
+	case ZipRecord::eStored:
+		if ( m_istream.read( data->data(), data->size() ) != data->size() ) {
+			globalErrorStream() << "error reading zip file " << makeQuoted( m_name.c_str() ) << '\n';
+			delete data;
+			return 0;
+		}
+		break;
+	case ZipRecord::eDeflated:
+	{
+		Array<unsigned char> compressed( file->m_stream_size );
+		if ( m_istream.read( compressed.data(), compressed.size() ) != compressed.size() ) {
+			globalErrorStream() << "error reading zip file " << makeQuoted( m_name.c_str() ) << '\n';
+			delete data;
+			return 0;
+		}
+
+		z_stream zipstream;
+		zipstream.zalloc = 0;
+		zipstream.zfree = 0;
+		zipstream.opaque = 0;
+		zipstream.next_in = compressed.data();
+		zipstream.avail_in = static_cast<uInt>( compressed.size() );
+		zipstream.next_out = data->data();
+		zipstream.avail_out = static_cast<uInt>( data->size() );
+		if ( inflateInit2( &zipstream, -MAX_WBITS ) != Z_OK ) {
+			globalErrorStream() << "error inflating zip file " << makeQuoted( m_name.c_str() ) << '\n';
+			delete data;
+			return 0;
+		}
+		const int result = inflate( &zipstream, Z_FINISH );
+		inflateEnd( &zipstream );
+		// the entry must inflate to exactly its recorded size
+		if ( result != Z_STREAM_END || zipstream.avail_out != 0 ) {
+			globalErrorStream() << "error inflating zip file " << makeQuoted( m_name.c_str() ) << '\n';
+			delete data;
+			return 0;
+		}
+		break;
+	}
+	}
+
+	g_zipEntryCache.insert( this, file, data );
+	return data;
+}
 public:
 ZipArchive( const char* name )
 	: m_name( name ), m_istream( name ){
@@ -203,6 +365,7 @@ ZipArchive( const char* name )
 	}
 }
 ~ZipArchive(){
+	g_zipEntryCache.erase( this );
 	for ( ZipFileSystem::iterator i = m_filesystem.begin(); i != m_filesystem.end(); ++i )
 	{
 		delete i->second.file();
@@ -219,22 +382,9 @@ void release(){
 ArchiveFile* openFile( const char* name ){
 	ZipFileSystem::iterator i = m_filesystem.find( name );
 	if ( i != m_filesystem.end() && !i->second.is_directory() ) {
-		ZipRecord* file = i->second.file();
-
-		m_istream.seek( file->m_position );
-		zip_file_header file_header;
-		istream_read_zip_file_header( m_istream, file_header );
-		if ( file_header.z_magic != zip_file_header_magic ) {
-			globalErrorStream() << "error reading zip file " << makeQuoted( m_name.c_str() );
-			return 0;
-		}
-
-		switch ( file->m_mode )
-		{
-		case ZipRecord::eStored:
-			return StoredArchiveFile::create( name, m_name.c_str(), m_istream.tell(), file->m_stream_size, file->m_file_size );
-		case ZipRecord::eDeflated:
-			return new DeflatedArchiveFile( name, m_name.c_str(), m_istream.tell(), file->m_stream_size, file->m_file_size );
+		ZipEntryData* data = readFile( i->second.file() );
+		if ( data != 0 ) {
+			return new ZipEntryArchiveFile( name, data );
 		}
 	}
 	return 0;
@@ -242,22 +392,9 @@ ArchiveFile* openFile( const char* name ){
 ArchiveTextFile* openTextFile( const char* name ){
 	ZipFileSystem::iterator i = m_filesystem.find( name );
 	if ( i != m_filesystem.end() && !i->second.is_directory() ) {
-		ZipRecord* file = i->second.file();
-
-		m_istream.seek( file->m_position );
-		zip_file_header file_header;
-		istream_read_zip_file_header( m_istream, file_header );
-		if ( file_header.z_magic != zip_file_header_magic ) {
-			globalErrorStream() << "error reading zip file " << makeQuoted( m_name.c_str() );
-			return 0;
-		}
-
-		switch ( file->m_mode )
-		{
-		case ZipRecord::eStored:
-			return StoredArchiveTextFile::create( name, m_name.c_str(), m_istream.tell(), file->m_stream_size );
-		case ZipRecord::eDeflated:
-			return new DeflatedArchiveTextFile( name, m_name.c_str(), m_istream.tell(), file->m_stream_size );
+		ZipEntryData* data = readFile( i->second.file() );
+		if ( data != 0 ) {
+			return new ZipEntryArchiveTextFile( name, data );
 		}
 	}
 	return 0;
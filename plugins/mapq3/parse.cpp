@@ -21,7 +21,11 @@
 
 #include "parse.h"
 
+#include <algorithm>
+#include <deque>
 #include <list>
+#include <vector>
+#include <glib.h>
 
 #include "ientity.h"
 #include "ibrush.h"
@@ -32,6 +36,10 @@
 #include "string/string.h"
 #include "stringio.h"
 #include "eclasslib.h"
+#include "debugging/debugging.h"
+#include "stream/memstream.h"
+#include "stream/textstream.h"
+#include "script/scripttokeniser.h"
 
 inline MapImporter* Node_getMapImporter( scene::Node& node ){
 	return NodeTypeCast<MapImporter>::cast( node );
@@ -136,3 +144,357 @@ void Map_Read( scene::Node& root, Tokeniser& tokeniser, EntityCreator& entityTab
 		++count_entities;
 	}
 }
+
+
+/// \brief Follows just enough of the simple ScriptTokeniser grammar to find line breaks that fall between tokens.
+/// A map file split at such a line break tokenises to the same tokens as the whole file.
+class TokenBoundaryScanner
+{
+enum State
+{
+	eDefault,
+	eToken,
+	eQuote,
+	eSolidus,
+	eComment,
+	eBlockComment,
+	eBlockCommentEnd,
+};
+
+State m_state;
+/// The tokeniser has started a token with a slash and returned to its default state without emitting it.
+/// Whitespace and line breaks do not end such a token.
+bool m_open;
+public:
+TokenBoundaryScanner() : m_state( eDefault ), m_open( false ){
+}
+/// \brief Returns false if \p c is a line break inside a quoted token, which the tokeniser reports as an error.
+bool scan( char c ){
+	switch ( m_state )
+	{
+	case eDefault:
+		if ( c == '"' ) {
+			m_state = eQuote;
+		}
+		else if ( c == '/' ) {
+			m_state = eSolidus;
+		}
+		else if ( c > 32 ) {
+			m_state = eToken;
+		}
+		break;
+	case eToken:
+		if ( c == '"' ) {
+			m_state = eQuote;
+			m_open = false;
+		}
+		else if ( !( c > 32 ) ) {
+			m_state = eDefault;
+			m_open = false;
+		}
+		break;
+	case eQuote:
+		if ( c == '\n' ) {
+			return false;
+		}
+		if ( c == '"' ) {
+			m_state = eDefault;
+			m_open = false;
+		}
+		break;
+	case eSolidus:
+		if ( c == '/' ) {
+			m_state = eComment;
+		}
+		else if ( c == '*' ) {
+			m_state = eBlockComment;
+		}
+		else if ( c == '"' ) {
+			m_state = eQuote;
+			m_open = false;
+		}
+		else if ( c > 32 ) {
+			m_state = eDefault;
+			m_open = true;
+		}
+		else
+		{
+			m_state = eDefault;
+			m_open = false;
+		}
+		break;
+	case eComment:
+		if ( c == '\n' ) {
+			m_state = eDefault;
+		}
+		break;
+	case eBlockComment:
+		if ( c == '*' ) {
+			m_state = eBlockCommentEnd;
+		}
+		break;
+	case eBlockCommentEnd:
+		if ( c == '/' ) {
+			m_state = eDefault;
+		}
+		else if ( c != '*' ) {
+			m_state = eBlockComment;
+		}
+		break;
+	}
+	return true;
+}
+bool betweenTokens() const {
+	return m_state == eDefault && !m_open;
+}
+};
+
+/// \brief A section of a map file and the tokens read from it.
+class MapTokenChunk
+{
+public:
+struct Token
+{
+	std::size_t offset;
+	std::size_t line;
+	std::size_t column;
+};
+
+std::vector<char> m_text;
+std::size_t m_line;
+/// The section ends in a tokeniser error, so it is tokenised on the main thread where the error can be reported.
+bool m_serial;
+bool m_done;
+std::vector<char> m_tokens;
+std::vector<Token> m_index;
+
+MapTokenChunk() : m_line( 1 ), m_serial( false ), m_done( false ){
+}
+
+void tokenise(){
+	BufferInputStream istream( m_text.data(), m_text.size() );
+	ScriptTokeniser tokeniser( istream, false, m_line );
+	tokeniser.nextLine();
+	for ( const char* token = tokeniser.getToken(); token != 0; token = tokeniser.getToken() )
+	{
+		const Token entry = { m_tokens.size(), tokeniser.getLine(), tokeniser.getColumn() };
+		m_index.push_back( entry );
+		m_tokens.insert( m_tokens.end(), token, token + string_length( token ) + 1 );
+	}
+	std::vector<char>().swap( m_text );
+}
+};
+
+/// \brief Tokenises a map file on a pool of threads while the main thread builds the scene from the tokens already read.
+/// The file is split into sections at line breaks between tokens, and the tokens are handed out in file order with the same text, line and column as the simple tokeniser gives.
+class MapTokeniser : public Tokeniser
+{
+/// Size of each read from the input stream.
+static const std::size_t c_readSize = 1 << 16;
+/// Minimum size of a section tokenised by one thread.
+static const std::size_t c_chunkSize = 1 << 20;
+
+TextInputStream& m_istream;
+TokenBoundaryScanner m_scanner;
+/// Input read but not yet handed to a section, starting at line m_pendingLine.
+std::vector<char> m_pending;
+std::size_t m_pendingLine;
+std::size_t m_scanned;
+std::size_t m_scannedLines;
+/// End of the last line in m_pending that ends between tokens, or 0.
+std::size_t m_boundary;
+std::size_t m_boundaryLines;
+bool m_eof;
+
+std::deque<MapTokenChunk*> m_chunks;
+std::size_t m_chunksInFlight;
+GThreadPool* m_pool;
+GMutex m_mutex;
+GCond m_cond;
+
+MapTokenChunk* m_current;
+/// Keeps the last token of the previous section alive for ungetToken().
+MapTokenChunk* m_previous;
+std::size_t m_index;
+const char* m_token;
+std::size_t m_line;
+std::size_t m_column;
+bool m_unget;
+
+static void tokeniseChunk( gpointer data, gpointer user_data ){
+	MapTokenChunk* chunk = reinterpret_cast<MapTokenChunk*>( data );
+	MapTokeniser* self = reinterpret_cast<MapTokeniser*>( user_data );
+	chunk->tokenise();
+
+	g_mutex_lock( &self->m_mutex );
+	chunk->m_done = true;
+	g_cond_broadcast( &self->m_cond );
+	g_mutex_unlock( &self->m_mutex );
+}
+
+MapTokenChunk* readChunk(){
+	bool serial = false;
+	while ( !m_eof && ( m_pending.size() < c_chunkSize || m_boundary == 0 ) )
+	{
+		const std::size_t size = m_pending.size();
+		m_pending.resize( size + c_readSize );
+		const std::size_t count = m_istream.read( &m_pending[size], c_readSize );
+		m_pending.resize( size + count );
+		m_eof = count == 0;
+
+		for ( ; m_scanned != m_pending.size(); ++m_scanned )
+		{
+			const char c = m_pending[m_scanned];
+			if ( !m_scanner.scan( c ) ) {
+				// the tokeniser stops here, so nothing after this section is read
+				serial = true;
+				m_eof = true;
+				break;
+			}
+			if ( c == '\n' ) {
+				++m_scannedLines;
+				if ( m_scanner.betweenTokens() ) {
+					m_boundary = m_scanned + 1;
+					m_boundaryLines = m_scannedLines;
+				}
+			}
+		}
+	}
+
+	if ( m_pending.empty() ) {
+		return 0;
+	}
+
+	const std::size_t end = m_eof ? m_pending.size() : m_boundary;
+	MapTokenChunk* chunk = new MapTokenChunk;
+	chunk->m_text.assign( m_pending.begin(), m_pending.begin() + end );
+	chunk->m_line = m_pendingLine;
+	chunk->m_serial = serial;
+
+	m_pending.erase( m_pending.begin(), m_pending.begin() + end );
+	m_pendingLine += m_boundaryLines;
+	m_scanned -= std::min( m_scanned, end );
+	m_scannedLines -= m_boundaryLines;
+	m_boundary = 0;
+	m_boundaryLines = 0;
+	return chunk;
+}
+
+void queueChunks(){
+	while ( m_chunks.size() < m_chunksInFlight )
+	{
+		MapTokenChunk* chunk = readChunk();
+		if ( chunk == 0 ) {
+			break;
+		}
+		m_chunks.push_back( chunk );
+		if ( !chunk->m_serial ) {
+			g_thread_pool_push( m_pool, chunk, 0 );
+		}
+	}
+}
+
+bool nextChunk(){
+	delete m_previous;
+	m_previous = m_current;
+	m_current = 0;
+
+	queueChunks();
+	if ( m_chunks.empty() ) {
+		return false;
+	}
+
+	MapTokenChunk* chunk = m_chunks.front();
+	m_chunks.pop_front();
+	if ( chunk->m_serial ) {
+		chunk->tokenise();
+	}
+	else
+	{
+		g_mutex_lock( &m_mutex );
+		while ( !chunk->m_done )
+		{
+			g_cond_wait( &m_cond, &m_mutex );
+		}
+		g_mutex_unlock( &m_mutex );
+	}
+
+	m_current = chunk;
+	m_index = 0;
+	queueChunks();
+	return true;
+}
+
+public:
+MapTokeniser( TextInputStream& istream ) :
+	m_istream( istream ),
+	m_pendingLine( 1 ),
+	m_scanned( 0 ),
+	m_scannedLines( 0 ),
+	m_boundary( 0 ),
+	m_boundaryLines( 0 ),
+	m_eof( false ),
+	m_current( 0 ),
+	m_previous( 0 ),
+	m_index( 0 ),
+	m_token( 0 ),
+	m_line( 1 ),
+	m_column( 1 ),
+	m_unget( false ){
+	const std::size_t threads = std::max( 1, int( g_get_num_processors() ) );
+	m_chunksInFlight = threads * 2;
+	m_pool = g_thread_pool_new( tokeniseChunk, this, int( threads ), FALSE, 0 );
+	g_mutex_init( &m_mutex );
+	g_cond_init( &m_cond );
+}
+~MapTokeniser(){
+	// drop sections not yet started, and wait for the ones in progress
+	g_thread_pool_free( m_pool, TRUE, TRUE );
+	for ( std::deque<MapTokenChunk*>::iterator i = m_chunks.begin(); i != m_chunks.end(); ++i )
+	{
+		delete *i;
+	}
+	delete m_current;
+	delete m_previous;
+	g_cond_clear( &m_cond );
+	g_mutex_clear( &m_mutex );
+}
+void release(){
+	delete this;
+}
+void nextLine(){
+	// sections are always tokenised across line breaks, as the map reader requests
+}
+const char* getToken(){
+	if ( m_unget ) {
+		m_unget = false;
+		return m_token;
+	}
+
+	while ( m_current == 0 || m_index == m_current->m_index.size() )
+	{
+		if ( !nextChunk() ) {
+			return m_token = 0;
+		}
+	}
+
+	const MapTokenChunk::Token& token = m_current->m_index[m_index++];
+	m_line = token.line;
+	m_column = token.column;
+	return m_token = &m_current->m_tokens[token.offset];
+}
+void ungetToken(){
+	ASSERT_MESSAGE( !m_unget, "can't unget more than one token" );
+	m_unget = true;
+}
+std::size_t getLine() const {
+	return m_line;
+}
+std::size_t getColumn() const {
+	return m_column;
+}
+};
+
+Tokeniser& NewMapTokeniser( TextInputStream& istream ){
+	return *( new MapTokeniser( istream ) );
+}
@@ -35,6 +35,9 @@ virtual scene::Node& parsePrimitive( Tokeniser& tokeniser ) const = 0;
 
 void Map_Read( scene::Node& root, Tokeniser& tokeniser, EntityCreator& entityTable, const PrimitiveParser& parser );
 
+/// \brief Returns a tokeniser equivalent to the simple script tokeniser, which tokenises \p istream ahead of the reader on several threads.
+Tokeniser& NewMapTokeniser( TextInputStream& istream );
+
 namespace scene
 {
 class Node;
@@ -105,7 +105,7 @@ scene::Node& parsePrimitive( Tokeniser& tokeniser ) const {
 	return g_nullNode;
 }
 void readGraph( scene::Node& root, TextInputStream& inputStream, EntityCreator& entityTable ) const {
-	Tokeniser& tokeniser = GlobalScripLibModule::getTable().m_pfnNewSimpleTokeniser( inputStream );
+	Tokeniser& tokeniser = NewMapTokeniser( inputStream );
 	tokeniser.nextLine();
 	if ( !Tokeniser_parseToken( tokeniser, "Version" ) ) {
 		return;
@@ -180,7 +180,7 @@ scene::Node& parsePrimitive( Tokeniser& tokeniser ) const {
 	return g_nullNode;
 }
 void readGraph( scene::Node& root, TextInputStream& inputStream, EntityCreator& entityTable ) const {
-	Tokeniser& tokeniser = GlobalScripLibModule::getTable().m_pfnNewSimpleTokeniser( inputStream );
+	Tokeniser& tokeniser = NewMapTokeniser( inputStream );
 	tokeniser.nextLine();
 	if ( !Tokeniser_parseToken( tokeniser, "Version" ) ) {
 		return;
@@ -294,7 +294,7 @@ scene::Node& parsePrimitive( Tokeniser& tokeniser ) const {
 void readGraph( scene::Node& root, TextInputStream& inputStream, EntityCreator& entityTable ) const {
 	detectedFormat = false;
 	wrongFormat = false;
-	Tokeniser &tokeniser = GlobalScripLibModule::getTable().m_pfnNewSimpleTokeniser( inputStream );
+	Tokeniser &tokeniser = NewMapTokeniser( inputStream );
 	Map_Read( root, tokeniser, entityTable, *this );
 	tokeniser.release();
 }
@@ -340,7 +340,7 @@ scene::Node& parsePrimitive( Tokeniser& tokeniser ) const {
 	return g_nullNode;
 }
 void readGraph( scene::Node& root, TextInputStream& inputStream, EntityCreator& entityTable ) const {
-	Tokeniser& tokeniser = GlobalScripLibModule::getTable().m_pfnNewSimpleTokeniser( inputStream );
+	Tokeniser& tokeniser = NewMapTokeniser( inputStream );
 	Map_Read( root, tokeniser, entityTable, *this );
 	tokeniser.release();
 }
@@ -387,7 +387,7 @@ scene::Node& parsePrimitive( Tokeniser& tokeniser ) const {
 }
 
 void readGraph( scene::Node &root, TextInputStream &inputStream, EntityCreator &entityTable ) const {
-	Tokeniser& tokeniser = GlobalScripLibModule::getTable().m_pfnNewSimpleTokeniser( inputStream );
+	Tokeniser& tokeniser = NewMapTokeniser( inputStream );
 	Map_Read( root, tokeniser, entityTable, *this );
 	tokeniser.release();
 }
@@ -432,7 +432,7 @@ scene::Node& parsePrimitive( Tokeniser& tokeniser ) const {
 	return g_nullNode;
 }
 void readGraph( scene::Node& root, TextInputStream& inputStream, EntityCreator& entityTable ) const {
-	Tokeniser& tokeniser = GlobalScripLibModule::getTable().m_pfnNewSimpleTokeniser( inputStream );
+	Tokeniser& tokeniser = NewMapTokeniser( inputStream );
 	Map_Read( root, tokeniser, entityTable, *this );
 	tokeniser.release();
 }
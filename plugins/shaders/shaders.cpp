@@ -42,6 +42,7 @@
 #include <stdlib.h>
 #include <map>
 #include <list>
+#include <vector>
 
 #include "ifilesystem.h"
 #include "ishaders.h"
@@ -60,6 +61,7 @@
 #include "stream/memstream.h"
 #include "stream/stringstream.h"
 #include "stream/textfilestream.h"
+#include "script/scripttokeniser.h"
 #include "os/path.h"
 #include "os/dir.h"
 #include "os/file.h"
@@ -697,19 +699,27 @@ ShaderTemplate* findTemplate( const char* name ){
 class ShaderDefinition
 {
 public:
-ShaderDefinition( ShaderTemplate* shaderTemplate, const ShaderArguments& args, const char* filename )
-	: shaderTemplate( shaderTemplate ), args( args ), filename( filename ){
+ShaderDefinition( ShaderTemplate* shaderTemplate, const ShaderArguments& args, const char* filename, std::size_t line = 0 )
+	: shaderTemplate( shaderTemplate ), args( args ), filename( filename ), line( line ){
 }
 
+/// Null until the shader is first used, when it is parsed from \c line of \c filename.
 ShaderTemplate* shaderTemplate;
 ShaderArguments args;
 const char* filename;
+std::size_t line;
 };
 
 typedef std::map<CopiedString, ShaderDefinition> ShaderDefinitionMap;
 
 ShaderDefinitionMap g_shaderDefinitions;
 
+typedef std::multimap<CopiedString, ShaderDefinition> ShaderDuplicateMap;
+
+/// The definitions ignored because the name was already defined, in load order.
+/// Tried in turn if the definition in use fails to parse when first used.
+ShaderDuplicateMap g_shaderDuplicates;
+
 bool parseTemplateInstance( Tokeniser& tokeniser, const char* filename ){
 	CopiedString name;
 	RETURN_FALSE_IF_FAIL( Tokeniser_parseShaderName( tokeniser, name ) );
@@ -728,6 +738,7 @@ bool parseTemplateInstance( Tokeniser& tokeniser, const char* filename ){
 	if ( shaderTemplate != 0 ) {
 		if ( !g_shaderDefinitions.insert( ShaderDefinitionMap::value_type( name, ShaderDefinition( shaderTemplate, args, filename ) ) ).second ) {
 			globalErrorStream() << "shader instance: " << makeQuoted( name.c_str() ) << ": already exists, second definition ignored\n";
+			g_shaderDuplicates.insert( ShaderDuplicateMap::value_type( name, ShaderDefinition( shaderTemplate, args, filename ) ) );
 		}
 	}
 	return true;
@@ -1172,6 +1183,7 @@ void FreeShaders(){
 	g_shaders.clear();
 	g_shaderTemplates.clear();
 	g_shaderDefinitions.clear();
+	g_shaderDuplicates.clear();
 	g_ActiveShadersChangedNotify();
 }
 
@@ -1334,9 +1346,78 @@ Layer() : m_type( LAYER_NONE ), m_blendFunc( BLEND_ONE, BLEND_ZERO ), m_clampToB
 
 std::list<CopiedString> g_shaderFilenames;
 
-void ParseShaderFile( Tokeniser& tokeniser, const char* filename ){
-	g_shaderFilenames.push_back( filename );
-	filename = g_shaderFilenames.back().c_str();
+/// \brief The shaders defined in one shader file, and the file or archive it was read from.
+class ShaderFileIndex
+{
+public:
+typedef std::vector<std::pair<CopiedString, std::size_t> > Shaders;
+
+CopiedString m_source;
+FileTime m_modified;
+FileSize m_size;
+/// The name of each shader, and the line its name is on.
+Shaders m_shaders;
+
+ShaderFileIndex() : m_modified( c_invalidFileTime ), m_size( 0 ){
+}
+bool sameSource( const ShaderFileIndex& other ) const {
+	return string_equal( m_source.c_str(), other.m_source.c_str() )
+		   && m_modified == other.m_modified
+		   && m_size == other.m_size;
+}
+};
+
+typedef std::map<CopiedString, ShaderFileIndex> ShaderFileIndexMap;
+
+/// Kept across refreshes, so that only the shader files that changed are indexed again.
+ShaderFileIndexMap g_shaderFileIndex;
+
+void ShaderFile_findSource( const char* filename, ShaderFileIndex& index ){
+	const char* root = GlobalFileSystem().findFile( filename );
+	if ( string_empty( root ) ) {
+		return;
+	}
+	StringOutputStream path( 256 );
+	path << root;
+	if ( file_is_directory( root ) ) {
+		path << filename;
+	}
+	index.m_source = path.c_str();
+	index.m_modified = file_modified( path.c_str() );
+	index.m_size = file_size( path.c_str() );
+}
+
+/// \brief Skips a shader body, matching braces the same way as the shader parsers.
+bool Tokeniser_skipShaderBody( Tokeniser& tokeniser ){
+	int depth = 0;
+	for (;; )
+	{
+		tokeniser.nextLine();
+		const char* token = tokeniser.getToken();
+
+		if ( token == 0 ) {
+			return false;
+		}
+
+		if ( string_equal( token, "{" ) ) {
+			++depth;
+		}
+		else if ( string_equal( token, "}" ) ) {
+			--depth;
+			if ( depth < 0 ) { // underflow
+				return false;
+			}
+			if ( depth == 0 ) { // end of shader
+				return true;
+			}
+		}
+	}
+}
+
+/// \brief Finds the shaders defined in a shader file without parsing their bodies.
+/// Returns false if the file instantiates guides, which are parsed as they are found and so can't be indexed.
+bool IndexShaderFile( Tokeniser& tokeniser, const char* filename, ShaderFileIndex::Shaders& shaders ){
+	bool indexed = true;
 	tokeniser.nextLine();
 	for (;; )
 	{
@@ -1349,10 +1430,10 @@ void ParseShaderFile( Tokeniser& tokeniser, const char* filename ){
 		if ( string_equal( token, "table" ) ) {
 			if ( tokeniser.getToken() == 0 ) {
 				Tokeniser_unexpectedError( tokeniser, 0, "#table-name" );
-				return;
+				return indexed;
 			}
 			if ( !Tokeniser_parseToken( tokeniser, "{" ) ) {
-				return;
+				return indexed;
 			}
 			for (;; )
 			{
@@ -1367,7 +1448,7 @@ void ParseShaderFile( Tokeniser& tokeniser, const char* filename ){
 					}
 
 					if ( !Tokeniser_parseToken( tokeniser, "}" ) ) {
-						return;
+						return indexed;
 					}
 					break;
 				}
@@ -1377,6 +1458,7 @@ void ParseShaderFile( Tokeniser& tokeniser, const char* filename ){
 		{
 			if ( string_equal( token, "guide" ) ) {
 				parseTemplateInstance( tokeniser, filename );
+				indexed = false;
 			}
 			else
 			{
@@ -1389,32 +1471,109 @@ void ParseShaderFile( Tokeniser& tokeniser, const char* filename ){
 				CopiedString name;
 				if ( !Tokeniser_parseShaderName( tokeniser, name ) ) {
 				}
-				ShaderTemplatePointer shaderTemplate( new ShaderTemplate() );
-				shaderTemplate->setName( name.c_str() );
-
-				g_shaders.insert( ShaderTemplateMap::value_type( shaderTemplate->getName(), shaderTemplate ) );
+				const std::size_t line = tokeniser.getLine();
+				if ( !Tokeniser_skipShaderBody( tokeniser ) ) {
+					globalErrorStream() << "Error parsing shader " << name.c_str() << "\n";
+					return indexed;
+				}
+				shaders.push_back( ShaderFileIndex::Shaders::value_type( name, line ) );
+			}
+		}
+	}
+	return indexed;
+}
 
-				bool result = ( g_shaderLanguage == SHADERLANGUAGE_QUAKE3 )
-							  ? shaderTemplate->parseQuake3( tokeniser )
-							  : shaderTemplate->parseDoom3( tokeniser );
-				if ( result ) {
-					// do we already have this shader?
-					if ( !g_shaderDefinitions.insert( ShaderDefinitionMap::value_type( shaderTemplate->getName(), ShaderDefinition( shaderTemplate.get(), ShaderArguments(), filename ) ) ).second ) {
+void ShaderFile_addDefinitions( const char* filename, const ShaderFileIndex::Shaders& shaders ){
+	for ( ShaderFileIndex::Shaders::const_iterator i = shaders.begin(); i != shaders.end(); ++i )
+	{
+		// do we already have this shader?
+		if ( !g_shaderDefinitions.insert( ShaderDefinitionMap::value_type( ( *i ).first, ShaderDefinition( 0, ShaderArguments(), filename, ( *i ).second ) ) ).second ) {
+			g_shaderDuplicates.insert( ShaderDuplicateMap::value_type( ( *i ).first, ShaderDefinition( 0, ShaderArguments(), filename, ( *i ).second ) ) );
 #if GDEF_DEBUG
-						globalOutputStream() << "WARNING: shader " << shaderTemplate->getName() << " is already in memory, definition in " << filename << " ignored.\n";
+			globalOutputStream() << "WARNING: shader " << ( *i ).first.c_str() << " is already in memory, definition in " << filename << " ignored.\n";
 #endif
-					}
-				}
-				else
-				{
-					globalErrorStream() << "Error parsing shader " << shaderTemplate->getName() << "\n";
-					return;
-				}
-			}
 		}
 	}
 }
 
+/// The text of the shader file last parsed from, as shaders used together are usually defined together.
+CopiedString g_shaderTextFilename;
+std::vector<char> g_shaderText;
+/// The offset of the start of each line in g_shaderText.
+std::vector<std::size_t> g_shaderTextLines;
+
+void ShaderText_clear(){
+	g_shaderTextFilename = "";
+	std::vector<char>().swap( g_shaderText );
+	std::vector<std::size_t>().swap( g_shaderTextLines );
+}
+
+bool ShaderText_load( const char* filename ){
+	if ( !g_shaderTextLines.empty() && string_equal( g_shaderTextFilename.c_str(), filename ) ) {
+		return true;
+	}
+	ShaderText_clear();
+
+	ArchiveTextFile* file = GlobalFileSystem().openTextFile( filename );
+	if ( file == 0 ) {
+		globalOutputStream() << "Unable to read shaderfile " << filename << "\n";
+		return false;
+	}
+	char buffer[4096];
+	for ( std::size_t size = file->getInputStream().read( buffer, sizeof( buffer ) ); size != 0; size = file->getInputStream().read( buffer, sizeof( buffer ) ) )
+	{
+		g_shaderText.insert( g_shaderText.end(), buffer, buffer + size );
+	}
+	file->release();
+
+	g_shaderTextLines.push_back( 0 );
+	for ( std::size_t i = 0; i != g_shaderText.size(); ++i )
+	{
+		if ( g_shaderText[i] == '\n' ) {
+			g_shaderTextLines.push_back( i + 1 );
+		}
+	}
+	g_shaderTextFilename = filename;
+	return true;
+}
+
+/// \brief Parses the template of a shader definition indexed by LoadShaderFile.
+/// Returns 0 if the definition can't be parsed.
+ShaderTemplate* ShaderDefinition_parse( const char* name, const ShaderDefinition& definition ){
+	if ( !ShaderText_load( definition.filename ) || definition.line == 0 || definition.line > g_shaderTextLines.size() ) {
+		return 0;
+	}
+
+	const std::size_t offset = g_shaderTextLines[definition.line - 1];
+	BufferInputStream istream( g_shaderText.data() + offset, g_shaderText.size() - offset );
+	ScriptTokeniser tokeniser( istream, true, definition.line );
+	tokeniser.nextLine();
+
+	// skip anything before the name on the same line, such as the end of the previous shader
+	CopiedString found;
+	do
+	{
+		if ( !Tokeniser_parseShaderName( tokeniser, found ) ) {
+			return 0;
+		}
+	}
+	while ( !string_equal( found.c_str(), name ) );
+
+	ShaderTemplatePointer shaderTemplate( new ShaderTemplate() );
+	shaderTemplate->setName( name );
+
+	bool result = ( g_shaderLanguage == SHADERLANGUAGE_QUAKE3 )
+				  ? shaderTemplate->parseQuake3( tokeniser )
+				  : shaderTemplate->parseDoom3( tokeniser );
+	if ( !result ) {
+		globalErrorStream() << "Error parsing shader " << name << "\n";
+		return 0;
+	}
+
+	g_shaders.insert( ShaderTemplateMap::value_type( shaderTemplate->getName(), shaderTemplate ) );
+	return shaderTemplate.get();
+}
+
 void parseGuideFile( Tokeniser& tokeniser, const char* filename ){
 	tokeniser.nextLine();
 	for (;; )
@@ -1454,22 +1613,41 @@ void parseGuideFile( Tokeniser& tokeniser, const char* filename ){
 }
 
 void LoadShaderFile( const char* filename ){
-	ArchiveTextFile* file = GlobalFileSystem().openTextFile( filename );
+	g_shaderFilenames.push_back( filename );
+	filename = g_shaderFilenames.back().c_str();
+
+	ShaderFileIndex found;
+	ShaderFile_findSource( filename, found );
+
+	ShaderFileIndexMap::iterator i = g_shaderFileIndex.find( filename );
+	if ( i == g_shaderFileIndex.end() || found.m_modified == c_invalidFileTime || !( *i ).second.sameSource( found ) ) {
+		if ( i != g_shaderFileIndex.end() ) {
+			g_shaderFileIndex.erase( i );
+		}
+
+		ArchiveTextFile* file = GlobalFileSystem().openTextFile( filename );
+		if ( file == 0 ) {
+			globalOutputStream() << "Unable to read shaderfile " << filename << "\n";
+			return;
+		}
 
-	if ( file != 0 ) {
 		globalOutputStream() << "Parsing shaderfile " << filename << "\n";
 
 		Tokeniser& tokeniser = GlobalScriptLibrary().m_pfnNewScriptTokeniser( file->getInputStream() );
 
-		ParseShaderFile( tokeniser, filename );
+		const bool indexed = IndexShaderFile( tokeniser, filename, found.m_shaders );
 
 		tokeniser.release();
 		file->release();
+
+		if ( !indexed || found.m_modified == c_invalidFileTime ) {
+			ShaderFile_addDefinitions( filename, found.m_shaders );
+			return;
+		}
+		i = g_shaderFileIndex.insert( ShaderFileIndexMap::value_type( filename, found ) ).first;
 	}
-	else
-	{
-		globalOutputStream() << "Unable to read shaderfile " << filename << "\n";
-	}
+
+	ShaderFile_addDefinitions( filename, ( *i ).second.m_shaders );
 }
 
 void loadGuideFile( const char* filename ){
@@ -1504,6 +1682,24 @@ CShader* Try_Shader_ForName( const char* name ){
 
 	// find matching shader definition
 	ShaderDefinitionMap::iterator i = g_shaderDefinitions.find( name );
+	if ( i != g_shaderDefinitions.end() && ( *i ).second.shaderTemplate == 0 ) {
+		// shader definition was indexed but not yet parsed
+		( *i ).second.shaderTemplate = ShaderDefinition_parse( ( *i ).first.c_str(), ( *i ).second );
+		// fall back to the later definitions of the same name, as when every definition was parsed on load
+		std::pair<ShaderDuplicateMap::iterator, ShaderDuplicateMap::iterator> duplicates = g_shaderDuplicates.equal_range( ( *i ).first );
+		for ( ShaderDuplicateMap::iterator j = duplicates.first; ( *i ).second.shaderTemplate == 0 && j != duplicates.second; ++j )
+		{
+			( *i ).second = ( *j ).second;
+			if ( ( *i ).second.shaderTemplate == 0 ) {
+				( *i ).second.shaderTemplate = ShaderDefinition_parse( ( *i ).first.c_str(), ( *i ).second );
+			}
+		}
+		g_shaderDuplicates.erase( duplicates.first, duplicates.second );
+		if ( ( *i ).second.shaderTemplate == 0 ) {
+			g_shaderDefinitions.erase( i );
+			i = g_shaderDefinitions.end();
+		}
+	}
 	if ( i == g_shaderDefinitions.end() ) {
 		// shader definition was not found
 
@@ -1718,6 +1914,7 @@ void Shaders_Load(){
 void Shaders_Free(){
 	FreeShaders();
 	FreeShaderList();
+	ShaderText_clear();
 	g_shaderFilenames.clear();
 }
 
@@ -1730,7 +1927,10 @@ bool Shaders_realised(){
 
 void Shaders_Realise(){
 	if ( --g_shaders_unrealised == 0 ) {
-		Shaders_Load();
+		{
+			ModuleTraceScope trace( "shaders", "load shaders" );
+			Shaders_Load();
+		}
 		g_observers.realise();
 	}
 }
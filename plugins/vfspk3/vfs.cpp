@@ -58,6 +58,7 @@ ArchiveModules& FileSystemQ3API_getArchiveModules();
 #include "string/string.h"
 #include "stream/stringstream.h"
 #include "os/path.h"
+#include "os/thread.h"
 #include "moduleobservers.h"
 #include "filematch.h"
 #include "dpkdeps.h"
@@ -83,14 +84,25 @@ struct archive_entry_t
 	CopiedString name;
 	Archive* archive;
 	bool is_pakfile;
+	std::size_t order; // position in the search path
 };
 
 #include <list>
 #include <map>
+#include <set>
+#include <vector>
 
 typedef std::list<archive_entry_t> archives_t;
 
 static archives_t g_archives;
+
+/// \brief For every file in a pak file, the pak files that contain it, in search order.
+/// Directory archives are not indexed: their contents may change while the filesystem is loaded.
+typedef std::vector<const archive_entry_t*> archive_entries_t;
+typedef std::map<CopiedString, archive_entries_t, StringLessNoCase> file_index_t;
+static file_index_t g_file_index;
+/// \brief The directory archives, in search order.
+static archive_entries_t g_directories;
 static char g_strDirs[VFS_MAXDIRS][PATH_MAX + 1];
 static int g_numDirs;
 static char g_strForbiddenDirs[VFS_MAXDIRS][PATH_MAX + 1];
@@ -134,26 +146,132 @@ const _QERArchiveTable* GetArchiveTable( ArchiveModules& archiveModules, const c
 	return archiveModules.findModule( tmp.c_str() );
 }
 
+class FileIndexVisitor : public Archive::Visitor
+{
+const archive_entry_t& m_entry;
+public:
+FileIndexVisitor( const archive_entry_t& entry ) : m_entry( entry ){
+}
+void visit( const char* name ){
+	archive_entries_t& archives = g_file_index[name];
+	if ( archives.empty() || archives.back() != &m_entry ) {
+		archives.push_back( &m_entry );
+	}
+}
+};
+
+/// \brief Appends \p entry to the search path, after all archives added before it.
+static void AddArchive( archive_entry_t& entry ){
+	entry.order = g_archives.size();
+	g_archives.push_back( entry );
+	const archive_entry_t& added = g_archives.back();
+	if ( added.archive == 0 ) {
+		return;
+	}
+	if ( added.is_pakfile ) {
+		FileIndexVisitor visitor( added );
+		added.archive->forEachFile( Archive::VisitorFunc( visitor, Archive::eFiles, 0 ), "" );
+	}
+	else
+	{
+		g_directories.push_back( &added );
+	}
+}
+
+/// \brief Calls \p functor with each archive that may contain \p filename, in search order, until it returns true.
+/// Only the directories and the pak files which the index lists for \p filename are visited.
+template<typename Functor>
+static bool ForEachArchiveWithFile( const char* filename, const Functor& functor ){
+	static const archive_entries_t empty;
+	file_index_t::const_iterator found = g_file_index.find( filename );
+	const archive_entries_t& paks = ( found != g_file_index.end() ) ? ( *found ).second : empty;
+
+	archive_entries_t::const_iterator dir = g_directories.begin();
+	archive_entries_t::const_iterator pak = paks.begin();
+	while ( dir != g_directories.end() || pak != paks.end() )
+	{
+		const archive_entry_t* entry;
+		if ( pak == paks.end() || ( dir != g_directories.end() && ( *dir )->order < ( *pak )->order ) ) {
+			entry = *dir++;
+		}
+		else
+		{
+			entry = *pak++;
+		}
+		if ( functor( *entry ) ) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void AddPakFile( const char* filename, Archive* archive ){
+	archive_entry_t entry;
+	entry.name = filename;
+	entry.archive = archive;
+	entry.is_pakfile = true;
+	AddArchive( entry );
+	globalOutputStream() << "pak file: " << filename << "\n";
+}
+
 static Archive* InitPakFile( ArchiveModules& archiveModules, const char *filename ){
 	const _QERArchiveTable* table = GetArchiveTable( archiveModules, path_get_extension( filename ) );
 
 	if ( table != 0 ) {
-		archive_entry_t entry;
-		entry.name = filename;
+		Archive* archive = table->m_pfnOpenArchive( filename );
+		AddPakFile( filename, archive );
+		return archive;
+	}
 
-		entry.archive = table->m_pfnOpenArchive( filename );
-		entry.is_pakfile = true;
-		g_archives.push_back( entry );
-		globalOutputStream() << "pak file: " << filename << "\n";
+	return 0;
+}
 
-		return entry.archive;
+struct pakfile_open_t
+{
+	CopiedString filename;
+	const _QERArchiveTable* table;
+	Archive* archive;
+};
+
+/// \brief Opens the pak files named in \p filenames and adds them to the search path in the order given.
+/// Opening a pak file reads its whole directory and is independent of every other pak file, so large sets
+/// are opened on several threads; the search path and the file index are only touched once all are open.
+static void InitPakFiles( ArchiveModules& archiveModules, const std::vector<CopiedString>& filenames ){
+	std::vector<pakfile_open_t> paks;
+	for ( std::vector<CopiedString>::const_iterator i = filenames.begin(); i != filenames.end(); ++i )
+	{
+		const _QERArchiveTable* table = GetArchiveTable( archiveModules, path_get_extension( ( *i ).c_str() ) );
+		if ( table != 0 ) {
+			pakfile_open_t pak;
+			pak.filename = *i;
+			pak.table = table;
+			pak.archive = 0;
+			paks.push_back( pak );
+		}
 	}
 
-	return 0;
+	thread_run_jobs( paks.size(), 2, "vfs pak open", [&paks]( std::size_t i ){
+		paks[i].archive = paks[i].table->m_pfnOpenArchive( paks[i].filename.c_str() );
+	} );
+
+	for ( std::vector<pakfile_open_t>::const_iterator i = paks.begin(); i != paks.end(); ++i )
+	{
+		AddPakFile( ( *i ).filename.c_str(), ( *i ).archive );
+	}
 }
 
-inline void pathlist_prepend_unique( GSList*& pathlist, char* path ){
-	if ( g_slist_find_custom( pathlist, path, (GCompareFunc)path_compare ) == 0 ) {
+struct PathLess
+{
+	bool operator()( const char* path, const char* other ) const {
+		return path_compare( path, other ) < 0;
+	}
+};
+
+/// \brief The paths already in a list, so that each new one is checked in O(log n).
+typedef std::set<const char*, PathLess> pathlist_set_t;
+
+inline void pathlist_prepend_unique( GSList*& pathlist, pathlist_set_t& paths, char* path ){
+	if ( paths.insert( path ).second ) {
 		pathlist = g_slist_prepend( pathlist, path );
 	}
 	else
@@ -165,10 +283,11 @@ inline void pathlist_prepend_unique( GSList*& pathlist, char* path ){
 class DirectoryListVisitor : public Archive::Visitor
 {
 GSList*& m_matches;
+pathlist_set_t& m_paths;
 const char* m_directory;
 public:
-DirectoryListVisitor( GSList*& matches, const char* directory )
-	: m_matches( matches ), m_directory( directory )
+DirectoryListVisitor( GSList*& matches, pathlist_set_t& paths, const char* directory )
+	: m_matches( matches ), m_paths( paths ), m_directory( directory )
 {}
 void visit( const char* name ){
 	const char* subname = path_make_relative( name, m_directory );
@@ -181,7 +300,7 @@ void visit( const char* name ){
 		if ( last_char != dir && *( --last_char ) == '/' ) {
 			*last_char = '\0';
 		}
-		pathlist_prepend_unique( m_matches, dir );
+		pathlist_prepend_unique( m_matches, m_paths, dir );
 	}
 }
 };
@@ -189,11 +308,12 @@ void visit( const char* name ){
 class FileListVisitor : public Archive::Visitor
 {
 GSList*& m_matches;
+pathlist_set_t& m_paths;
 const char* m_directory;
 const char* m_extension;
 public:
-FileListVisitor( GSList*& matches, const char* directory, const char* extension )
-	: m_matches( matches ), m_directory( directory ), m_extension( extension )
+FileListVisitor( GSList*& matches, pathlist_set_t& paths, const char* directory, const char* extension )
+	: m_matches( matches ), m_paths( paths ), m_directory( directory ), m_extension( extension )
 {}
 void visit( const char* name ){
 	const char* subname = path_make_relative( name, m_directory );
@@ -202,7 +322,7 @@ void visit( const char* name ){
 			++subname;
 		}
 		if ( m_extension[0] == '*' || extension_equal( path_get_extension( subname ), m_extension ) ) {
-			pathlist_prepend_unique( m_matches, g_strdup( subname ) );
+			pathlist_prepend_unique( m_matches, m_paths, g_strdup( subname ) );
 		}
 	}
 }
@@ -210,13 +330,14 @@ void visit( const char* name ){
 
 static GSList* GetListInternal( const char *refdir, const char *ext, bool directories, std::size_t depth ){
 	GSList* files = 0;
+	pathlist_set_t paths;
 
 	ASSERT_MESSAGE( refdir[strlen( refdir ) - 1] == '/', "search path does not end in '/'" );
 
 	if ( directories ) {
 		for ( archives_t::iterator i = g_archives.begin(); i != g_archives.end(); ++i )
 		{
-			DirectoryListVisitor visitor( files, refdir );
+			DirectoryListVisitor visitor( files, paths, refdir );
 			( *i ).archive->forEachFile( Archive::VisitorFunc( visitor, Archive::eDirectories, depth ), refdir );
 		}
 	}
@@ -224,7 +345,7 @@ static GSList* GetListInternal( const char *refdir, const char *ext, bool direct
 	{
 		for ( archives_t::iterator i = g_archives.begin(); i != g_archives.end(); ++i )
 		{
-			FileListVisitor visitor( files, refdir, ext );
+			FileListVisitor visitor( files, paths, refdir, ext );
 			( *i ).archive->forEachFile( Archive::VisitorFunc( visitor, Archive::eFiles, depth ), refdir );
 		}
 	}
@@ -295,7 +416,7 @@ Archive* AddPakDir( const char* fullpath ){
 		entry.name = fullpath;
 		entry.archive = OpenArchive( fullpath );
 		entry.is_pakfile = false;
-		g_archives.push_back( entry );
+		AddArchive( entry );
 
 		return entry.archive;
 	}
@@ -504,7 +625,7 @@ void InitDirectory( const char* directory, ArchiveModules& archiveModules ){
 		entry.name = path;
 		entry.archive = OpenArchive( path );
 		entry.is_pakfile = false;
-		g_archives.push_back( entry );
+		AddArchive( entry );
 	}
 
 	if ( g_bUsePak ) {
@@ -629,6 +750,7 @@ void InitDirectory( const char* directory, ArchiveModules& archiveModules ){
 			}
 			else
 			{
+				std::vector<CopiedString> pakfiles;
 				for ( Archives::iterator i = archivesOverride.begin(); i != archivesOverride.end(); ++i )
 				{
 					const char* name = i->c_str();
@@ -638,7 +760,7 @@ void InitDirectory( const char* directory, ArchiveModules& archiveModules ){
 						|| ( is_pk3_vfs && !string_compare_nocase_upper( ext, ".pk3" ) )
 						|| ( is_pk4_vfs && !string_compare_nocase_upper( ext, ".pk4" ) ) ) {
 						fullpath = string_new_concat( path, i->c_str() );
-						InitPakFile( archiveModules, fullpath );
+						pakfiles.push_back( fullpath );
 						string_release( fullpath, string_length( fullpath ) );
 					}
 				}
@@ -652,10 +774,13 @@ void InitDirectory( const char* directory, ArchiveModules& archiveModules ){
 						|| ( is_pk3_vfs && !string_compare_nocase_upper( ext, ".pk3" ) )
 						|| ( is_pk4_vfs && !string_compare_nocase_upper( ext, ".pk4" ) ) ) {
 						fullpath = string_new_concat( path, i->c_str() );
-						InitPakFile( archiveModules, fullpath );
+						pakfiles.push_back( fullpath );
 						string_release( fullpath, string_length( fullpath ) );
 					}
 				}
+
+				ModuleTraceScope trace( "vfs", path );
+				InitPakFiles( archiveModules, pakfiles );
 			}
 		}
 		else
@@ -674,6 +799,8 @@ void Shutdown(){
 		( *i ).archive->release();
 	}
 	g_archives.clear();
+	g_file_index.clear();
+	g_directories.clear();
 
 	g_numDirs = 0;
 	g_numForbiddenDirs = 0;
@@ -697,43 +824,39 @@ int GetFileCount( const char *filename, int flag ){
 		flag = VFS_SEARCH_PAK | VFS_SEARCH_DIR;
 	}
 
-	for ( archives_t::iterator i = g_archives.begin(); i != g_archives.end(); ++i )
-	{
-		if ( (( *i ).is_pakfile && ( flag & VFS_SEARCH_PAK ) != 0)
-			 || (!( *i ).is_pakfile && ( flag & VFS_SEARCH_DIR ) != 0) ) {
-			if ( ( *i ).archive->containsFile( fixed ) ) {
+	ForEachArchiveWithFile( fixed, [&]( const archive_entry_t& entry ){
+		if ( ( entry.is_pakfile && ( flag & VFS_SEARCH_PAK ) != 0 )
+			 || ( !entry.is_pakfile && ( flag & VFS_SEARCH_DIR ) != 0 ) ) {
+			if ( entry.archive->containsFile( fixed ) ) {
 				++count;
 			}
 		}
-	}
+		return false;
+	} );
 
 	return count;
 }
 
 ArchiveFile* OpenFile( const char* filename ){
 	ASSERT_MESSAGE( strchr( filename, '\\' ) == 0, "path contains invalid separator '\\': \"" << filename << "\"" );
-	for ( archives_t::iterator i = g_archives.begin(); i != g_archives.end(); ++i )
-	{
-		ArchiveFile* file = ( *i ).archive->openFile( filename );
-		if ( file != 0 ) {
-			return file;
-		}
-	}
+	ArchiveFile* file = 0;
+	ForEachArchiveWithFile( filename, [&]( const archive_entry_t& entry ){
+		file = entry.archive->openFile( filename );
+		return file != 0;
+	} );
 
-	return 0;
+	return file;
 }
 
 ArchiveTextFile* OpenTextFile( const char* filename ){
 	ASSERT_MESSAGE( strchr( filename, '\\' ) == 0, "path contains invalid separator '\\': \"" << filename << "\"" );
-	for ( archives_t::iterator i = g_archives.begin(); i != g_archives.end(); ++i )
-	{
-		ArchiveTextFile* file = ( *i ).archive->openTextFile( filename );
-		if ( file != 0 ) {
-			return file;
-		}
-	}
+	ArchiveTextFile* file = 0;
+	ForEachArchiveWithFile( filename, [&]( const archive_entry_t& entry ){
+		file = entry.archive->openTextFile( filename );
+		return file != 0;
+	} );
 
-	return 0;
+	return file;
 }
 
 // NOTE: when loading a file, you have to allocate one extra byte and set it to \0
@@ -781,14 +904,16 @@ void ClearFileDirList( GSList **lst ){
 }
 
 const char* FindFile( const char* relative ){
-	for ( archives_t::iterator i = g_archives.begin(); i != g_archives.end(); ++i )
-	{
-		if ( ( *i ).archive->containsFile( relative ) ) {
-			return ( *i ).name.c_str();
+	const char* found = "";
+	ForEachArchiveWithFile( relative, [&]( const archive_entry_t& entry ){
+		if ( entry.archive->containsFile( relative ) ) {
+			found = entry.name.c_str();
+			return true;
 		}
-	}
+		return false;
+	} );
 
-	return "";
+	return found;
 }
 
 const char* FindPath( const char* absolute ){
@@ -23,9 +23,13 @@
 #include "autosave.h"
 #include "globaldefs.h"
 
+#include <vector>
+#include <glib.h>
+
 #include "os/file.h"
 #include "os/path.h"
 #include "cmdlib.h"
+#include "stream/textfilestream.h"
 #include "stream/stringstream.h"
 #include "gtkutil/messagebox.h"
 #include "scenelib.h"
@@ -42,6 +46,98 @@
 #endif
 
 
+/// \brief A copy of the map serialised on the main thread, written to disk on a background thread.
+/// The file is written under a temporary name and renamed over the target once complete, so an interrupted write never replaces the previous autosave.
+class AutosaveWrite
+{
+public:
+CopiedString m_filename;
+std::vector<char> m_text;
+bool m_success;
+volatile gint m_done;
+GThread* m_thread;
+
+AutosaveWrite( const char* filename ) : m_filename( filename ), m_success( false ), m_done( 0 ), m_thread( 0 ){
+}
+};
+
+class AutosaveTextOutputStream : public TextOutputStream
+{
+std::vector<char>& m_text;
+public:
+AutosaveTextOutputStream( std::vector<char>& text ) : m_text( text ){
+}
+std::size_t write( const char* buffer, std::size_t length ){
+	m_text.insert( m_text.end(), buffer, buffer + length );
+	return length;
+}
+};
+
+namespace
+{
+AutosaveWrite* g_autosaveWrite = 0;
+}
+
+gpointer AutosaveWrite_thread( gpointer data ){
+	AutosaveWrite& write = *reinterpret_cast<AutosaveWrite*>( data );
+
+	StringOutputStream temporary( 256 );
+	temporary << write.m_filename.c_str() << ".tmp";
+	{
+		// text mode, as Map_SaveFile writes, so that line endings match a real save
+		TextFileOutputStream file( temporary.c_str() );
+		write.m_success = !file.failed()
+						  && file.write( write.m_text.data(), write.m_text.size() ) == write.m_text.size();
+	}
+	if ( write.m_success ) {
+#if GDEF_OS_WINDOWS
+		// rename does not replace an existing file on windows
+		file_remove( write.m_filename.c_str() );
+#endif
+		write.m_success = file_move( temporary.c_str(), write.m_filename.c_str() );
+	}
+	else
+	{
+		file_remove( temporary.c_str() );
+	}
+
+	g_atomic_int_set( &write.m_done, 1 );
+	return 0;
+}
+
+/// \brief Reports the result of the pending autosave write once it has completed, or waits for it if \p wait is true.
+/// Returns true if no write is pending afterwards.
+bool AutosaveWrite_finish( bool wait ){
+	if ( g_autosaveWrite == 0 ) {
+		return true;
+	}
+	if ( !wait && g_atomic_int_get( &g_autosaveWrite->m_done ) == 0 ) {
+		return false;
+	}
+
+	g_thread_join( g_autosaveWrite->m_thread );
+	if ( g_autosaveWrite->m_success ) {
+		globalOutputStream() << "Autosaved " << g_autosaveWrite->m_filename.c_str() << "\n";
+	}
+	else
+	{
+		globalErrorStream() << "Autosave to " << makeQuoted( g_autosaveWrite->m_filename.c_str() ) << " failed\n";
+	}
+	delete g_autosaveWrite;
+	g_autosaveWrite = 0;
+	return true;
+}
+
+/// \brief Serialises the map to memory and writes it to \p filename on a background thread.
+void Map_AutosaveFile( const char* filename ){
+	AutosaveWrite_finish( true );
+
+	g_autosaveWrite = new AutosaveWrite( filename );
+	AutosaveTextOutputStream text( g_autosaveWrite->m_text );
+	Map_Export( text, Map_getFormat( g_map ) );
+	g_autosaveWrite->m_thread = g_thread_new( "autosave", AutosaveWrite_thread, g_autosaveWrite );
+}
+
 bool DoesFileExist( const char* name, std::size_t& size ){
 	if ( file_exists( name ) ) {
 		size += file_size( name );
@@ -83,7 +179,7 @@ void Map_Snapshot(){
 		}
 
 		// save in the next available slot
-		Map_SaveFile( snapshotFilename.c_str() );
+		Map_AutosaveFile( snapshotFilename.c_str() );
 
 		if ( lSize > 50 * 1024 * 1024 ) { // total size of saves > 50 mb
 			globalOutputStream() << "The snapshot files in " << snapshotsDir.c_str() << " total more than 50 megabytes. You might consider cleaning up.";
@@ -124,6 +220,8 @@ scene::Node& Map_Node(){
 }
 
 void QE_CheckAutoSave( void ){
+	AutosaveWrite_finish( false );
+
 	if ( !Map_Valid( g_map ) || !ScreenUpdates_Enabled() ) {
 		return;
 	}
@@ -155,7 +253,7 @@ void QE_CheckAutoSave( void ){
 					autosave << g_qeglobals.m_userGamePath.c_str() << "maps/";
 					Q_mkdir( autosave.c_str() );
 					autosave << "autosave.map";
-					Map_SaveFile( autosave.c_str() );
+					Map_AutosaveFile( autosave.c_str() );
 				}
 				else
 				{
@@ -163,7 +261,7 @@ void QE_CheckAutoSave( void ){
 					const char* extension = path_get_filename_base_end( name );
 					StringOutputStream autosave( 256 );
 					autosave << StringRange( name, extension ) << ".autosave" << extension;
-					Map_SaveFile( autosave.c_str() );
+					Map_AutosaveFile( autosave.c_str() );
 				}
 			}
 		}
@@ -202,4 +300,5 @@ void Autosave_Construct(){
 }
 
 void Autosave_Destroy(){
+	AutosaveWrite_finish( true );
 }
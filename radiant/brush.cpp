@@ -22,6 +22,8 @@
 #include "brush.h"
 #include "signal/signal.h"
 
+#include "os/thread.h"
+
 Signal0 g_brushTextureChangedCallbacks;
 
 void Brush_addTextureChangedCallback( const SignalHandler& handler ){
@@ -40,6 +42,7 @@ bool g_brush_texturelock_enabled = true;
 EBrushType Brush::m_type;
 double Brush::m_maxWorldCoord = 0;
 Shader* Brush::m_state_point;
+std::vector<Brush*> Brush::m_changed;
 Shader* BrushClipPlane::m_state = 0;
 Shader* BrushInstance::m_state_selpoint;
 Counter* BrushInstance::m_counter = 0;
@@ -104,8 +107,35 @@ inline bool Brush_isBounded( const Brush& brush ){
 	return true;
 }
 
+/// Fewest changed brushes worth building on more than one thread.
+const std::size_t c_brush_parallelWindings = 256;
+
+void Brush::buildChangedWindings(){
+	if ( m_changed.size() < c_brush_parallelWindings ) {
+		return;
+	}
+
+	// a pending transform is applied through the brush's faces, which notifies the scene and the lights, so it is evaluated here before any worker reads a plane
+	for ( std::size_t i = 0; i != m_changed.size(); ++i )
+	{
+		m_changed[i]->evaluateTransform();
+	}
+
+	thread_run_jobs( m_changed.size(), c_brush_parallelWindings / 4, "brush windings", []( std::size_t i ){
+		m_changed[i]->buildPendingWindings();
+	} );
+
+	for ( std::vector<Brush*>::iterator i = m_changed.begin(); i != m_changed.end(); ++i )
+	{
+		( *i )->m_changedIndex = c_brush_notChanged;
+	}
+	m_changed.clear();
+}
+
 void Brush::buildBRep(){
-	bool degenerate = buildWindings();
+	changedErase();
+	bool degenerate = m_windingsBuilt ? m_windingsDegenerate : buildWindings();
+	m_windingsBuilt = false;
 
 	std::size_t faces_size = 0;
 	std::size_t faceVerticesCount = 0;
@@ -47,6 +47,7 @@
 #include "moduleobserver.h"
 
 #include <set>
+#include <vector>
 
 #include "cullable.h"
 #include "renderable.h"
@@ -112,6 +113,20 @@ inline void Winding_DrawWireframe( const Winding& winding ){
 	glDrawArrays( GL_LINE_LOOP, 0, GLsizei( winding.numpoints ) );
 }
 
+inline bool Winding_getPolygon( const Winding& winding, const Vector3& normal, OpenGLPolygon& polygon ){
+	if ( winding.numpoints < 3 ) {
+		return false;
+	}
+	polygon.vertices = reinterpret_cast<const float*>( &winding.points.data()->vertex );
+	polygon.texcoords = reinterpret_cast<const float*>( &winding.points.data()->texcoord );
+	polygon.stride = sizeof( WindingVertex );
+	polygon.count = static_cast<unsigned int>( winding.numpoints );
+	polygon.normal[0] = normal.x();
+	polygon.normal[1] = normal.y();
+	polygon.normal[2] = normal.z();
+	return true;
+}
+
 inline void Winding_Draw( const Winding& winding, const Vector3& normal, RenderStateFlags state ){
 	glVertexPointer( 3, GL_FLOAT, sizeof( WindingVertex ), &winding.points.data()->vertex );
 
@@ -192,6 +207,7 @@ inline void Winding_Draw( const Winding& winding, const Vector3& normal, RenderS
 
 
 #include "shaderlib.h"
+#include "string/pooledstring.h"
 
 typedef DoubleVector3 PlanePoints[3];
 
@@ -352,7 +368,8 @@ public:
 class SavedState
 {
 public:
-CopiedString m_shader;
+/// shared between all saved states that use the same shader
+PooledString< LazyStatic<StringPool> > m_shader;
 ContentsFlagsValue m_flags;
 
 SavedState( const FaceShader& faceShader ){
@@ -903,6 +920,10 @@ void exportState( Face& face ) const {
 void release(){
 	delete this;
 }
+
+std::size_t memorySize() const {
+	return sizeof( *this );
+}
 };
 
 public:
@@ -1018,6 +1039,10 @@ void render( RenderStateFlags state ) const {
 	Winding_Draw( m_winding, m_planeTransformed.plane3().normal(), state );
 }
 
+bool getPolygon( OpenGLPolygon& polygon ) const {
+	return Winding_getPolygon( m_winding, m_planeTransformed.plane3().normal(), polygon );
+}
+
 void updateFiltered(){
 	m_filtered = face_filtered( *this );
 }
@@ -1061,6 +1086,9 @@ void DecRef(){
 		delete this;
 	}
 }
+std::size_t refcount() const {
+	return m_refcount;
+}
 
 void flipWinding(){
 	m_plane.reverse();
@@ -1413,6 +1441,11 @@ inline bool plane3_inside( const Plane3& self, const Plane3& other, bool selfIsL
 typedef SmartPointer<Face> FaceSmartPointer;
 typedef std::vector<FaceSmartPointer> Faces;
 
+/// \brief Returns an estimate of the memory owned by \p face, including its winding.
+inline std::size_t Face_memorySize( const Face& face ){
+	return sizeof( Face ) + face.getWinding().numpoints * sizeof( WindingVertex );
+}
+
 /// \brief Returns the unique-id of the edge adjacent to \p faceVertex in the edge-pair for the set of \p faces.
 inline FaceVertexId next_edge( const Faces& faces, FaceVertexId faceVertex ){
 	std::size_t adjacent_face = faces[faceVertex.getFace()]->getWinding()[faceVertex.getVertex()].adjacent;
@@ -1521,6 +1554,8 @@ public:
 virtual void visit( Face& face ) const = 0;
 };
 
+const std::size_t c_brush_notChanged = std::size_t( -1 );
+
 class Brush :
 	public TransformNode,
 	public Bounded,
@@ -1568,8 +1603,14 @@ Callback<void()> m_boundsChanged;
 
 mutable bool m_planeChanged;   // b-rep evaluation required
 mutable bool m_transformChanged;   // transform evaluation required
+bool m_windingsBuilt;   // face windings already built for the pending b-rep evaluation
+bool m_windingsDegenerate;
+std::size_t m_changedIndex;   // position in m_changed, or c_brush_notChanged
 // ----
 
+/// Brushes whose face windings must be built before their next b-rep evaluation.
+static std::vector<Brush*> m_changed;
+
 public:
 STRING_CONSTANT( Name, "Brush" );
 
@@ -1592,7 +1633,10 @@ Brush( scene::Node& node, const Callback<void()>& evaluateTransform, const Callb
 	m_evaluateTransform( evaluateTransform ),
 	m_boundsChanged( boundsChanged ),
 	m_planeChanged( false ),
-	m_transformChanged( false ){
+	m_transformChanged( false ),
+	m_windingsBuilt( false ),
+	m_windingsDegenerate( false ),
+	m_changedIndex( c_brush_notChanged ){
 	planeChanged();
 }
 Brush( const Brush& other, scene::Node& node, const Callback<void()>& evaluateTransform, const Callback<void()>& boundsChanged ) :
@@ -1605,7 +1649,10 @@ Brush( const Brush& other, scene::Node& node, const Callback<void()>& evaluateTr
 	m_evaluateTransform( evaluateTransform ),
 	m_boundsChanged( boundsChanged ),
 	m_planeChanged( false ),
-	m_transformChanged( false ){
+	m_transformChanged( false ),
+	m_windingsBuilt( false ),
+	m_windingsDegenerate( false ),
+	m_changedIndex( c_brush_notChanged ){
 	copy( other );
 }
 
@@ -1626,12 +1673,16 @@ Brush( const Brush& other ) :
 	m_render_vertices( m_uniqueVertexPoints, GL_POINTS ),
 	m_render_edges( m_uniqueEdgePoints, GL_POINTS ),
 	m_planeChanged( false ),
-	m_transformChanged( false ){
+	m_transformChanged( false ),
+	m_windingsBuilt( false ),
+	m_windingsDegenerate( false ),
+	m_changedIndex( c_brush_notChanged ){
 	copy( other );
 }
 
 ~Brush(){
 	ASSERT_MESSAGE( m_observers.empty(), "Brush::~Brush: observers still attached" );
+	changedErase();
 }
 
 // assignment not supported
@@ -1744,6 +1795,8 @@ void updateFiltered(){
 // observer
 void planeChanged(){
 	m_planeChanged = true;
+	m_windingsBuilt = false;
+	changedInsert();
 	aabbChanged();
 	m_lightsChanged();
 }
@@ -1755,11 +1808,16 @@ void shaderChanged(){
 
 void evaluateBRep() const {
 	if ( m_planeChanged ) {
+		buildChangedWindings();
 		m_planeChanged = false;
 		const_cast<Brush*>( this )->buildBRep();
 	}
 }
 
+/// \brief Builds the face windings of every changed brush ahead of its b-rep evaluation.
+/// After a bulk change such as a map load or a transform of a large selection, the windings are built on several threads, which leaves each brush only the serial remainder of its b-rep to evaluate.
+static void buildChangedWindings();
+
 void transformChanged(){
 	m_transformChanged = true;
 	planeChanged();
@@ -1868,9 +1926,31 @@ void release(){
 	delete this;
 }
 
+std::size_t memorySize() const {
+	std::size_t size = sizeof( *this ) + m_faces.capacity() * sizeof( FaceSmartPointer );
+	for ( Faces::const_iterator i = m_faces.begin(); i != m_faces.end(); ++i )
+	{
+		// faces still used by the brush are shared, not owned
+		if ( ( *i )->refcount() == 1 ) {
+			size += Face_memorySize( *( *i ) );
+		}
+	}
+	return size;
+}
+
 Faces m_faces;
 };
 
+/// \brief Returns an estimate of the memory owned by the brush and its faces.
+std::size_t memorySize() const {
+	std::size_t size = sizeof( *this ) + m_faces.capacity() * sizeof( FaceSmartPointer );
+	for ( Faces::const_iterator i = m_faces.begin(); i != m_faces.end(); ++i )
+	{
+		size += Face_memorySize( *( *i ) );
+	}
+	return size;
+}
+
 void undoSave(){
 	if ( m_map != 0 ) {
 		m_map->changed();
@@ -2178,6 +2258,28 @@ void copy( const Brush& other ){
 }
 
 private:
+void changedInsert(){
+	if ( m_changedIndex == c_brush_notChanged ) {
+		m_changedIndex = m_changed.size();
+		m_changed.push_back( this );
+	}
+}
+
+void changedErase(){
+	if ( m_changedIndex != c_brush_notChanged ) {
+		m_changed.back()->m_changedIndex = m_changedIndex;
+		m_changed[m_changedIndex] = m_changed.back();
+		m_changed.pop_back();
+		m_changedIndex = c_brush_notChanged;
+	}
+}
+
+/// \brief Builds the face windings for the pending b-rep evaluation. Touches no state outside this brush once any pending transform has been evaluated, so such brushes may be built concurrently.
+void buildPendingWindings(){
+	m_windingsDegenerate = buildWindings();
+	m_windingsBuilt = true;
+}
+
 void edge_push_back( FaceVertexId faceVertex ){
 	m_select_edges.push_back( SelectableEdge( m_faces, faceVertex ) );
 	for ( Observers::iterator i = m_observers.begin(); i != m_observers.end(); ++i )
@@ -30,7 +30,8 @@
 class BrushNode :
 	public scene::Node::Symbiot,
 	public scene::Instantiable,
-	public scene::Cloneable
+	public scene::Cloneable,
+	public UndoMemorySize
 {
 class TypeCasts
 {
@@ -39,6 +40,7 @@ public:
 TypeCasts(){
 	NodeStaticCast<BrushNode, scene::Instantiable>::install( m_casts );
 	NodeStaticCast<BrushNode, scene::Cloneable>::install( m_casts );
+	NodeStaticCast<BrushNode, UndoMemorySize>::install( m_casts );
 	NodeContainedCast<BrushNode, Snappable>::install( m_casts );
 	NodeContainedCast<BrushNode, TransformNode>::install( m_casts );
 	NodeContainedCast<BrushNode, Brush>::install( m_casts );
@@ -125,6 +127,10 @@ scene::Node& clone() const {
 	return ( new BrushNode( *this ) )->node();
 }
 
+std::size_t memorySize() const {
+	return sizeof( *this ) - sizeof( Brush ) + m_brush.memorySize();
+}
+
 scene::Instance* create( const scene::Path& path, scene::Instance* parent ){
 	return new BrushInstance( path, parent, m_brush );
 }
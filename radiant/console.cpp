@@ -22,6 +22,8 @@
 #include "console.h"
 
 #include <time.h>
+#include <deque>
+#include <string>
 #include <uilib/uilib.h>
 #include <gtk/gtk.h>
 
@@ -41,15 +43,31 @@
 namespace
 {
 FILE* g_hLogFile;
+/// Guards g_hLogFile, as any thread may print, and printing an error opens the log. Recursive, as opening the log prints.
+GRecMutex g_hLogFileLock;
+/// The thread the program started on, the only one that may show an alert.
+GThread* g_logFileMainThread = g_thread_self();
+/// Set while an alert raised on another thread waits for the main loop, so that it is shown once.
+gint g_logFileAlertQueued = 0;
+
+gboolean Sys_LogFile_alert( gpointer data ){
+	ui::alert( ui::root, "Failed to create log file, check write permissions in " RADIANT_NAME " directory.\n",
+			   "Console logging", ui::alert_type::OK, ui::alert_icon::Error );
+	g_atomic_int_set( &g_logFileAlertQueued, 0 );
+	return FALSE;
+}
 }
 
 bool g_Console_enableLogging = false;
 
 // called whenever we need to open/close/check the console log file
 void Sys_LogFile( bool enable ){
+	bool failed = false;
+	g_rec_mutex_lock( &g_hLogFileLock );
 	if ( enable && !g_hLogFile ) {
 		// settings say we should be logging and we don't have a log file .. so create it
 		if ( !SettingsPath_get()[0] ) {
+			g_rec_mutex_unlock( &g_hLogFileLock );
 			return; // cannot open a log file yet
 		}
 		// open a file to log the console (if user prefs say so)
@@ -66,8 +84,7 @@ void Sys_LogFile( bool enable ){
 								 << "This is " RADIANT_NAME " " RADIANT_VERSION " compiled " __DATE__ "\n" RADIANT_ABOUTMSG "\n";
 		}
 		else{
-			ui::alert( ui::root, "Failed to create log file, check write permissions in " RADIANT_NAME " directory.\n",
-							"Console logging", ui::alert_type::OK, ui::alert_icon::Error );
+			failed = true;
 		}
 	}
 	else if ( !enable && g_hLogFile != 0 ) {
@@ -78,9 +95,20 @@ void Sys_LogFile( bool enable ){
 		fclose( g_hLogFile );
 		g_hLogFile = 0;
 	}
+	g_rec_mutex_unlock( &g_hLogFileLock );
+
+	if ( failed ) {
+		if ( g_thread_self() == g_logFileMainThread ) {
+			Sys_LogFile_alert( 0 );
+		}
+		else if ( g_atomic_int_compare_and_exchange( &g_logFileAlertQueued, 0, 1 ) ) {
+			g_idle_add( Sys_LogFile_alert, 0 );
+		}
+	}
 }
 
 ui::TextView g_console{ui::null};
+GThread* g_console_thread;
 
 void console_clear(){
 	g_console.text("");
@@ -116,6 +144,7 @@ ui::Widget Console_constructWindow( ui::Window toplevel ){
 		scr.add(text);
 		text.show();
 		g_console = text;
+		g_console_thread = g_thread_self();
 
 		//globalExtendedASCIICharacterSet().print();
 
@@ -132,6 +161,63 @@ ui::Widget Console_constructWindow( ui::Window toplevel ){
 	return scr;
 }
 
+namespace
+{
+/// Milliseconds between insertions of pending output into the console widget.
+const guint c_console_flushInterval = 33;
+/// Most lines kept in the console widget. The oldest lines are removed as new ones arrive; the log file keeps everything.
+const gint c_console_maxLines = 10000;
+/// Most bytes of output waiting for the next insertion. The oldest pending output is dropped beyond this.
+const std::size_t c_console_maxPending = 1 << 20;
+
+/// Consecutive output written at one print level.
+struct ConsoleRun
+{
+	int level;
+	std::string text;
+};
+
+/// Output written since the last insertion into the console widget, in order. Guarded by g_console_lock, as any thread may print.
+std::deque<ConsoleRun> g_console_pending;
+std::size_t g_console_pendingSize = 0;
+GMutex g_console_lock;
+guint g_console_flushId = 0;
+gint64 g_console_lastFlush = 0;
+
+gboolean console_flush_timeout( gpointer data );
+
+void Console_queue( int level, const char* buf, std::size_t length ){
+	g_mutex_lock( &g_console_lock );
+	if ( g_console_pending.empty() || g_console_pending.back().level != level ) {
+		g_console_pending.push_back( ConsoleRun() );
+		g_console_pending.back().level = level;
+	}
+	g_console_pending.back().text.append( buf, length );
+	g_console_pendingSize += length;
+
+	while ( g_console_pendingSize > c_console_maxPending )
+	{
+		std::string& oldest = g_console_pending.front().text;
+		if ( g_console_pending.size() == 1 ) {
+			// drop whole lines, so that no multi-byte character is split
+			const std::size_t newline = oldest.find( '\n', g_console_pendingSize - c_console_maxPending );
+			const std::size_t excess = newline == std::string::npos ? oldest.size() : newline + 1;
+			oldest.erase( 0, excess );
+			g_console_pendingSize -= excess;
+		}
+		else
+		{
+			g_console_pendingSize -= oldest.size();
+			g_console_pending.pop_front();
+		}
+	}
+
+	if ( g_console_flushId == 0 ) {
+		g_console_flushId = g_timeout_add( c_console_flushInterval, console_flush_timeout, 0 );
+	}
+	g_mutex_unlock( &g_console_lock );
+}
+
 class GtkTextBufferOutputStream : public TextOutputStream
 {
 GtkTextBuffer* textBuffer;
@@ -146,6 +232,84 @@ std::size_t write( const char* buffer, std::size_t length ){
 }
 };
 
+/// \brief Inserts all pending output into the console widget at once, then trims it to c_console_maxLines. Main thread only.
+void Console_flush(){
+	std::deque<ConsoleRun> runs;
+	g_mutex_lock( &g_console_lock );
+	runs.swap( g_console_pending );
+	g_console_pendingSize = 0;
+	g_mutex_unlock( &g_console_lock );
+
+	g_console_lastFlush = g_get_monotonic_time();
+
+	if ( !g_console || runs.empty() ) {
+		return;
+	}
+
+	auto buffer = gtk_text_view_get_buffer( g_console );
+
+	GtkTextIter iter;
+	gtk_text_buffer_get_end_iter( buffer, &iter );
+
+	static auto end = gtk_text_buffer_create_mark( buffer, "end", &iter, FALSE );
+
+	const GdkColor yellow = { 0, 0xb0ff, 0xb0ff, 0x0000 };
+	const GdkColor red = { 0, 0xffff, 0x0000, 0x0000 };
+
+	static auto error_tag = gtk_text_buffer_create_tag( buffer, "red_foreground", "foreground-gdk", &red, NULL );
+	static auto warning_tag = gtk_text_buffer_create_tag( buffer, "yellow_foreground", "foreground-gdk", &yellow, NULL );
+	static auto standard_tag = gtk_text_buffer_create_tag( buffer, "black_foreground", NULL );
+
+	for ( std::deque<ConsoleRun>::const_iterator i = runs.begin(); i != runs.end(); ++i )
+	{
+		GtkTextTag* tag;
+		switch ( ( *i ).level )
+		{
+		case SYS_WRN:
+			tag = warning_tag;
+			break;
+		case SYS_ERR:
+			tag = error_tag;
+			break;
+		case SYS_STD:
+		case SYS_VRB:
+		default:
+			tag = standard_tag;
+			break;
+		}
+
+		GtkTextBufferOutputStream textBuffer( buffer, &iter, tag );
+		if ( !globalCharacterSet().isUTF8() ) {
+			BufferedTextOutputStream<GtkTextBufferOutputStream> buffered( textBuffer );
+			buffered << StringRange( ( *i ).text.data(), ( *i ).text.data() + ( *i ).text.size() );
+		}
+		else
+		{
+			textBuffer << StringRange( ( *i ).text.data(), ( *i ).text.data() + ( *i ).text.size() );
+		}
+	}
+
+	const gint lines = gtk_text_buffer_get_line_count( buffer );
+	if ( lines > c_console_maxLines ) {
+		GtkTextIter first, last;
+		gtk_text_buffer_get_start_iter( buffer, &first );
+		gtk_text_buffer_get_iter_at_line( buffer, &last, lines - c_console_maxLines );
+		gtk_text_buffer_delete( buffer, &first, &last );
+	}
+
+	gtk_text_view_scroll_mark_onscreen( g_console, end );
+}
+
+gboolean console_flush_timeout( gpointer data ){
+	g_mutex_lock( &g_console_lock );
+	g_console_flushId = 0;
+	g_mutex_unlock( &g_console_lock );
+
+	Console_flush();
+	return FALSE;
+}
+}
+
 std::size_t Sys_Print( int level, const char* buf, std::size_t length ){
 	bool contains_newline = std::find( buf, buf + length, '\n' ) != buf + length;
 
@@ -153,65 +317,29 @@ std::size_t Sys_Print( int level, const char* buf, std::size_t length ){
 		Sys_LogFile( true );
 	}
 
+	g_rec_mutex_lock( &g_hLogFileLock );
+
 	if ( g_hLogFile != 0 ) {
 		fwrite( buf, 1, length, g_hLogFile );
 		if ( contains_newline ) {
 			fflush( g_hLogFile );
 		}
 	}
+	g_rec_mutex_unlock( &g_hLogFileLock );
 
 	if ( level != SYS_NOCON ) {
-		if ( g_console ) {
-			auto buffer = gtk_text_view_get_buffer( g_console );
-
-			GtkTextIter iter;
-			gtk_text_buffer_get_end_iter( buffer, &iter );
-
-			static auto end = gtk_text_buffer_create_mark( buffer, "end", &iter, FALSE );
-
-			const GdkColor yellow = { 0, 0xb0ff, 0xb0ff, 0x0000 };
-			const GdkColor red = { 0, 0xffff, 0x0000, 0x0000 };
-
-			static auto error_tag = gtk_text_buffer_create_tag( buffer, "red_foreground", "foreground-gdk", &red, NULL );
-			static auto warning_tag = gtk_text_buffer_create_tag( buffer, "yellow_foreground", "foreground-gdk", &yellow, NULL );
-			static auto standard_tag = gtk_text_buffer_create_tag( buffer, "black_foreground", NULL );
-			GtkTextTag* tag;
-			switch ( level )
-			{
-			case SYS_WRN:
-				tag = warning_tag;
-				break;
-			case SYS_ERR:
-				tag = error_tag;
-				break;
-			case SYS_STD:
-			case SYS_VRB:
-			default:
-				tag = standard_tag;
-				break;
-			}
-
-
-			{
-				GtkTextBufferOutputStream textBuffer( buffer, &iter, tag );
-				if ( !globalCharacterSet().isUTF8() ) {
-					BufferedTextOutputStream<GtkTextBufferOutputStream> buffered( textBuffer );
-					buffered << StringRange( buf, buf + length );
-				}
-				else
-				{
-					textBuffer << StringRange( buf, buf + length );
-				}
-			}
-
-			// update console widget immediatly if we're doing something time-consuming
-			if ( contains_newline ) {
-				gtk_text_view_scroll_mark_onscreen( g_console, end );
-
-				if ( !ScreenUpdates_Enabled() && gtk_widget_get_realized( g_console ) ) {
-					ScreenUpdates_process();
-				}
-			}
+		// output is inserted into the widget at most once per flush interval, however much is printed
+		Console_queue( level, buf, length );
+
+		// update console widget promptly if we're doing something time-consuming, as the main loop is not running
+		if ( contains_newline
+			 && g_console
+			 && g_thread_self() == g_console_thread
+			 && !ScreenUpdates_Enabled()
+			 && gtk_widget_get_realized( g_console )
+			 && g_get_monotonic_time() - g_console_lastFlush >= gint64( c_console_flushInterval ) * 1000 ) {
+			Console_flush();
+			ScreenUpdates_process();
 		}
 	}
 	return length;
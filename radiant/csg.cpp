@@ -24,11 +24,13 @@
 #include "debugging/debugging.h"
 
 #include <list>
+#include <algorithm>
 
 #include "map.h"
 #include "brushmanip.h"
 #include "brushnode.h"
 #include "grid.h"
+#include "selection.h"
 
 void Face_makeBrush( Face& face, const Brush& brush, brush_vector_t& out, float offset ){
 	if ( face.contributes() ) {
@@ -159,6 +161,7 @@ void Scene_BrushMakeHollow_Selected( scene::Graph& graph, bool makeRoom ){
 
 void CSG_MakeHollow( void ){
 	UndoableCommand undo( "brushHollow" );
+	SceneChangeBatch batch;
 
 	Scene_BrushMakeHollow_Selected( GlobalSceneGraph(), false );
 
@@ -167,6 +170,7 @@ void CSG_MakeHollow( void ){
 
 void CSG_MakeRoom( void ){
 	UndoableCommand undo( "brushRoom" );
+	SceneChangeBatch batch;
 
 	Scene_BrushMakeHollow_Selected( GlobalSceneGraph(), true );
 
@@ -321,14 +325,134 @@ bool Brush_subtract( const Brush& brush, const Brush& other, brush_vector_t& ret
 	return false;
 }
 
+/// \brief A bounding-box tree over a list of brushes, finding the brushes whose bounds may intersect a given box without testing each of them.
+class BrushAABBTree
+{
+struct Item
+{
+	AABB m_aabb;
+	std::size_t m_index;   // position in the brush list
+};
+class ItemLess
+{
+std::size_t m_axis;
+public:
+ItemLess( std::size_t axis ) : m_axis( axis ){
+}
+bool operator()( const Item& self, const Item& other ) const {
+	return self.m_aabb.origin[m_axis] < other.m_aabb.origin[m_axis];
+}
+};
+struct Node
+{
+	AABB m_aabb;
+	std::size_t m_first;   // range of m_items below this node
+	std::size_t m_last;
+	std::size_t m_children;   // index of the first of two children, or 0 for a leaf
+};
+
+/// Most brushes held by a leaf.
+static const std::size_t c_leafSize = 4;
+
+std::vector<Item> m_items;
+std::vector<Node> m_nodes;
+/// Brushes with invalid bounds, which aabb_intersects_aabb does not reliably reject, so always reported.
+std::vector<std::size_t> m_unbounded;
+
+void build( std::size_t node, std::size_t first, std::size_t last ){
+	Vector3 mins( m_items[first].m_aabb.origin - m_items[first].m_aabb.extents );
+	Vector3 maxs( m_items[first].m_aabb.origin + m_items[first].m_aabb.extents );
+	for ( std::size_t i = first + 1; i != last; ++i )
+	{
+		for ( std::size_t j = 0; j != 3; ++j )
+		{
+			mins[j] = std::min( mins[j], m_items[i].m_aabb.origin[j] - m_items[i].m_aabb.extents[j] );
+			maxs[j] = std::max( maxs[j], m_items[i].m_aabb.origin[j] + m_items[i].m_aabb.extents[j] );
+		}
+	}
+	// padded, so that rounding never rejects a box intersecting one of the brushes below
+	AABB aabb( vector3_mid( mins, maxs ), vector3_added( vector3_scaled( vector3_subtracted( maxs, mins ), 0.5f ), Vector3( 1, 1, 1 ) ) );
+
+	std::size_t children = 0;
+	if ( last - first > c_leafSize ) {
+		const std::size_t axis = aabb.extents[0] >= aabb.extents[1]
+								 ? ( aabb.extents[0] >= aabb.extents[2] ? 0 : 2 )
+								 : ( aabb.extents[1] >= aabb.extents[2] ? 1 : 2 );
+		const std::size_t middle = first + ( last - first ) / 2;
+		std::nth_element( m_items.begin() + first, m_items.begin() + middle, m_items.begin() + last, ItemLess( axis ) );
+
+		children = m_nodes.size();
+		m_nodes.resize( children + 2 );
+		build( children, first, middle );
+		build( children + 1, middle, last );
+	}
+
+	Node& self = m_nodes[node];
+	self.m_aabb = aabb;
+	self.m_first = first;
+	self.m_last = last;
+	self.m_children = children;
+}
+
+void query( std::size_t node, const AABB& aabb, std::vector<std::size_t>& indices ) const {
+	const Node& self = m_nodes[node];
+	if ( !aabb_intersects_aabb( self.m_aabb, aabb ) ) {
+		return;
+	}
+	if ( self.m_children != 0 ) {
+		query( self.m_children, aabb, indices );
+		query( self.m_children + 1, aabb, indices );
+		return;
+	}
+	for ( std::size_t i = self.m_first; i != self.m_last; ++i )
+	{
+		if ( aabb_intersects_aabb( m_items[i].m_aabb, aabb ) ) {
+			indices.push_back( m_items[i].m_index );
+		}
+	}
+}
+
+public:
+BrushAABBTree( const brush_vector_t& brushes ){
+	m_items.reserve( brushes.size() );
+	for ( brush_vector_t::const_iterator i = brushes.begin(); i != brushes.end(); ++i )
+	{
+		const AABB& aabb = ( *i )->localAABB();
+		if ( aabb_valid( aabb ) ) {
+			Item item = { aabb, std::size_t( i - brushes.begin() ) };
+			m_items.push_back( item );
+		}
+		else
+		{
+			m_unbounded.push_back( std::size_t( i - brushes.begin() ) );
+		}
+	}
+	if ( !m_items.empty() ) {
+		m_nodes.resize( 1 );
+		build( 0, 0, m_items.size() );
+	}
+}
+
+/// \brief Stores in \p indices the positions in the brush list of the brushes whose bounds may intersect \p aabb, in list order.
+void query( const AABB& aabb, std::vector<std::size_t>& indices ) const {
+	indices = m_unbounded;
+	if ( !m_nodes.empty() ) {
+		query( 0, aabb, indices );
+	}
+	std::sort( indices.begin(), indices.end() );
+}
+};
+
 class SubtractBrushesFromUnselected : public scene::Graph::Walker
 {
 const brush_vector_t& m_brushlist;
+const BrushAABBTree& m_tree;
 std::size_t& m_before;
 std::size_t& m_after;
+mutable std::vector<std::size_t> m_candidates;
 public:
-SubtractBrushesFromUnselected( const brush_vector_t& brushlist, std::size_t& before, std::size_t& after )
-	: m_brushlist( brushlist ), m_before( before ), m_after( after ){
+SubtractBrushesFromUnselected( const brush_vector_t& brushlist, const BrushAABBTree& tree, std::size_t& before, std::size_t& after )
+	: m_brushlist( brushlist ), m_tree( tree ), m_before( before ), m_after( after ){
 }
 
 bool pre( const scene::Path& path, scene::Instance& instance ) const {
@@ -340,17 +464,23 @@ void post( const scene::Path& path, scene::Instance& instance ) const {
 		Brush* brush = Node_getBrush( path.top() );
 		if ( brush != 0
 			 && !Instance_getSelectable( instance )->isSelected() ) {
+			// every fragment lies within the original brush, so a selected brush that cannot touch the original cannot cut any fragment either
+			m_tree.query( brush->localAABB(), m_candidates );
+			if ( m_candidates.empty() ) {
+				return;
+			}
+
 			brush_vector_t buffer[2];
 			bool swap = false;
 			Brush* original = new Brush( *brush );
 			buffer[static_cast<std::size_t>( swap )].push_back( original );
 
 			{
-				for ( brush_vector_t::const_iterator i( m_brushlist.begin() ); i != m_brushlist.end(); ++i )
+				for ( std::vector<std::size_t>::const_iterator i( m_candidates.begin() ); i != m_candidates.end(); ++i )
 				{
 					for ( brush_vector_t::iterator j( buffer[static_cast<std::size_t>( swap )].begin() ); j != buffer[static_cast<std::size_t>( swap )].end(); ++j )
 					{
-						if ( Brush_subtract( *( *j ), *( *i ), buffer[static_cast<std::size_t>( !swap )] ) ) {
+						if ( Brush_subtract( *( *j ), *m_brushlist[*i], buffer[static_cast<std::size_t>( !swap )] ) ) {
 							delete ( *j );
 						}
 						else
@@ -404,11 +534,12 @@ void CSG_Subtract(){
 		globalOutputStream() << "CSG Subtract: Subtracting " << Unsigned( selected_brushes.size() ) << " brushes.\n";
 
 		UndoableCommand undo( "brushSubtract" );
+		SceneChangeBatch batch;
 
 		// subtract selected from unselected
 		std::size_t before = 0;
 		std::size_t after = 0;
-		GlobalSceneGraph().traverse( SubtractBrushesFromUnselected( selected_brushes, before, after ) );
+		GlobalSceneGraph().traverse( SubtractBrushesFromUnselected( selected_brushes, BrushAABBTree( selected_brushes ), before, after ) );
 		globalOutputStream() << "CSG Subtract: Result: "
 							 << Unsigned( after ) << " fragment" << ( after == 1 ? "" : "s" )
 							 << " from " << Unsigned( before ) << " brush" << ( before == 1 ? "" : "es" ) << ".\n";
@@ -483,6 +614,7 @@ void post( const scene::Path& path, scene::Instance& instance ) const {
 };
 
 void Scene_BrushSplitByPlane( scene::Graph& graph, const Vector3& p0, const Vector3& p1, const Vector3& p2, const char* shader, EBrushSplit split ){
+	SceneChangeBatch batch;
 	TextureProjection projection;
 	TexDef_Construct_Default( projection );
 	graph.traverse( BrushSplitByPlaneSelected( p0, p1, p2, shader, projection, split ) );
@@ -617,6 +749,7 @@ void CSG_Merge( void ){
 	globalOutputStream() << "CSG Merge: Merging " << Unsigned( selected_brushes.size() ) << " brushes.\n";
 
 	UndoableCommand undo( "brushMerge" );
+	SceneChangeBatch batch;
 
 	scene::Path merged_path = GlobalSelectionSystem().ultimateSelected().path();
 
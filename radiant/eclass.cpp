@@ -24,6 +24,7 @@
 #include "debugging/debugging.h"
 
 #include <map>
+#include <vector>
 
 #include "ifilesystem.h"
 
@@ -31,7 +32,11 @@
 #include "eclasslib.h"
 #include "os/path.h"
 #include "os/dir.h"
+#include "os/file.h"
 #include "stream/stringstream.h"
+#include "stream/filestream.h"
+#include "container/hashtable.h"
+#include "container/hashfunc.h"
 #include "moduleobservers.h"
 
 #include "cmdlib.h"
@@ -42,8 +47,26 @@
 
 namespace
 {
+struct RawStringHashNoCase
+{
+	typedef hash_t hash_type;
+	hash_type operator()( const char* string ) const {
+		return string_hash_nocase( string );
+	}
+};
+
+struct RawStringEqualNoCase
+{
+	bool operator()( const char* x, const char* y ) const {
+		return string_equal_nocase( x, y );
+	}
+};
+
 typedef std::map<const char*, EntityClass*, RawStringLessNoCase> EntityClasses;
 EntityClasses g_entityClasses;
+/// The same classes as g_entityClasses, hashed for lookup by name. The map keeps them in order for Eclass_forEach.
+typedef HashTable<const char*, EntityClass*, RawStringHashNoCase, RawStringEqualNoCase> EntityClassIndex;
+EntityClassIndex g_entityClassIndex;
 EntityClass   *eclass_bad = 0;
 char eclass_directory[1024];
 typedef std::map<CopiedString, ListAttributeType> ListAttributeTypes;
@@ -65,6 +88,7 @@ void CleanEntityList( EntityClasses& entityClasses ){
 }
 
 void Eclass_Clear(){
+	g_entityClassIndex.clear();
 	CleanEntityList( g_entityClasses );
 	g_listTypes.clear();
 }
@@ -74,6 +98,10 @@ EntityClass* EClass_InsertSortedList( EntityClasses& entityClasses, EntityClass
 	if ( !result.second ) {
 		entityClass->free( entityClass );
 	}
+	else
+	{
+		g_entityClassIndex.insert( entityClass->name(), entityClass );
+	}
 	return ( *result.first ).second;
 }
 
@@ -111,6 +139,420 @@ const ListAttributeType* EntityClass_findListType( const char* name ){
 }
 
 
+/// \brief The classes and list types that one definition file produced, keyed by the file's absolute path.
+///
+/// A file whose modification time and size are unchanged, or whose contents hash the same, is replayed from
+/// its record instead of being parsed again.
+struct EntityClassFileRecord
+{
+	FileTime m_modified;
+	FileSize m_size;
+	hash_t m_hash;
+	std::vector<EntityClass> m_classes;
+	std::vector<std::pair<CopiedString, ListAttributeType>> m_listTypes;
+};
+
+namespace
+{
+typedef std::map<CopiedString, EntityClassFileRecord> EntityClassFileRecords;
+EntityClassFileRecords g_entityClassCache;
+bool g_entityClassCacheLoaded = false;
+bool g_entityClassCacheChanged = false;
+
+const char c_entityClassCacheMagic[8] = { 'R', 'A', 'D', 'E', 'C', 'L', 'S', '\0' };
+const unsigned int c_entityClassCacheVersion = 1;
+const unsigned int c_entityClassCacheEnd = 0xffffffffu;
+}
+
+/// \brief Appends little-endian values to a byte buffer that is written out in one go.
+class EntityClassCacheWriter
+{
+std::vector<unsigned char> m_buffer;
+public:
+const std::vector<unsigned char>& buffer() const {
+	return m_buffer;
+}
+void writeBytes( const void* data, std::size_t length ){
+	m_buffer.insert( m_buffer.end(), static_cast<const unsigned char*>( data ), static_cast<const unsigned char*>( data ) + length );
+}
+void writeUInt32( unsigned int value ){
+	for ( std::size_t i = 0; i != 4; ++i )
+	{
+		m_buffer.push_back( static_cast<unsigned char>( value >> ( i * 8 ) ) );
+	}
+}
+void writeUInt64( unsigned long long value ){
+	writeUInt32( static_cast<unsigned int>( value ) );
+	writeUInt32( static_cast<unsigned int>( value >> 32 ) );
+}
+void writeFloat( float value ){
+	unsigned int bits;
+	memcpy( &bits, &value, sizeof( bits ) );
+	writeUInt32( bits );
+}
+void writeBool( bool value ){
+	m_buffer.push_back( value ? 1 : 0 );
+}
+void writeString( const char* string ){
+	const std::size_t length = string_length( string );
+	writeUInt32( static_cast<unsigned int>( length ) );
+	writeBytes( string, length );
+}
+void writeVector3( const Vector3& vector ){
+	writeFloat( vector[0] );
+	writeFloat( vector[1] );
+	writeFloat( vector[2] );
+}
+};
+
+/// \brief Reads back what EntityClassCacheWriter wrote; any read past the end marks the reader as failed.
+class EntityClassCacheReader
+{
+const unsigned char* m_data;
+const unsigned char* m_end;
+bool m_failed;
+public:
+EntityClassCacheReader( const unsigned char* data, std::size_t length ) : m_data( data ), m_end( data + length ), m_failed( false ){
+}
+bool failed() const {
+	return m_failed;
+}
+const unsigned char* readBytes( std::size_t length ){
+	if ( m_failed || static_cast<std::size_t>( m_end - m_data ) < length ) {
+		m_failed = true;
+		return 0;
+	}
+	const unsigned char* data = m_data;
+	m_data += length;
+	return data;
+}
+unsigned int readUInt32(){
+	const unsigned char* data = readBytes( 4 );
+	if ( data == 0 ) {
+		return 0;
+	}
+	return static_cast<unsigned int>( data[0] ) | ( static_cast<unsigned int>( data[1] ) << 8 )
+		   | ( static_cast<unsigned int>( data[2] ) << 16 ) | ( static_cast<unsigned int>( data[3] ) << 24 );
+}
+unsigned long long readUInt64(){
+	const unsigned long long low = readUInt32();
+	return low | ( static_cast<unsigned long long>( readUInt32() ) << 32 );
+}
+float readFloat(){
+	const unsigned int bits = readUInt32();
+	float value;
+	memcpy( &value, &bits, sizeof( value ) );
+	return value;
+}
+bool readBool(){
+	const unsigned char* data = readBytes( 1 );
+	return data != 0 && *data != 0;
+}
+CopiedString readString(){
+	const std::size_t length = readUInt32();
+	const unsigned char* data = readBytes( length );
+	if ( data == 0 ) {
+		return CopiedString();
+	}
+	return CopiedString( StringRange( reinterpret_cast<const char*>( data ), reinterpret_cast<const char*>( data ) + length ) );
+}
+Vector3 readVector3(){
+	const float x = readFloat();
+	const float y = readFloat();
+	const float z = readFloat();
+	return Vector3( x, y, z );
+}
+};
+
+void EntityClass_writeCached( EntityClassCacheWriter& writer, const EntityClass& eclass ){
+	writer.writeString( eclass.m_name.c_str() );
+	writer.writeUInt32( static_cast<unsigned int>( eclass.m_parent.size() ) );
+	for ( StringList::const_iterator i = eclass.m_parent.begin(); i != eclass.m_parent.end(); ++i )
+	{
+		writer.writeString( ( *i ).c_str() );
+	}
+	writer.writeBool( eclass.fixedsize );
+	writer.writeBool( eclass.unknown );
+	writer.writeVector3( eclass.mins );
+	writer.writeVector3( eclass.maxs );
+	writer.writeVector3( eclass.color );
+	writer.writeString( eclass.m_comments.c_str() );
+	for ( std::size_t i = 0; i != MAX_FLAGS; ++i )
+	{
+		writer.writeBytes( eclass.flagnames[i], sizeof( eclass.flagnames[i] ) );
+	}
+	writer.writeString( eclass.m_modelpath.c_str() );
+	writer.writeString( eclass.m_skin.c_str() );
+	writer.writeUInt32( static_cast<unsigned int>( eclass.m_attributes.size() ) );
+	for ( EntityClassAttributes::const_iterator i = eclass.m_attributes.begin(); i != eclass.m_attributes.end(); ++i )
+	{
+		writer.writeString( ( *i ).first.c_str() );
+		writer.writeString( ( *i ).second.m_type.c_str() );
+		writer.writeString( ( *i ).second.m_name.c_str() );
+		writer.writeString( ( *i ).second.m_value.c_str() );
+		writer.writeString( ( *i ).second.m_description.c_str() );
+	}
+	writer.writeBool( eclass.inheritanceResolved );
+	writer.writeBool( eclass.sizeSpecified );
+	writer.writeBool( eclass.colorSpecified );
+}
+
+void EntityClass_readCached( EntityClassCacheReader& reader, EntityClass& eclass ){
+	eclass.m_name = reader.readString();
+	for ( std::size_t count = reader.readUInt32(); count != 0 && !reader.failed(); --count )
+	{
+		eclass.m_parent.push_back( reader.readString() );
+	}
+	eclass.fixedsize = reader.readBool();
+	eclass.unknown = reader.readBool();
+	eclass.mins = reader.readVector3();
+	eclass.maxs = reader.readVector3();
+	eclass.color = reader.readVector3();
+	eclass.m_comments = reader.readString();
+	for ( std::size_t i = 0; i != MAX_FLAGS; ++i )
+	{
+		const unsigned char* flagname = reader.readBytes( sizeof( eclass.flagnames[i] ) );
+		if ( flagname != 0 ) {
+			memcpy( eclass.flagnames[i], flagname, sizeof( eclass.flagnames[i] ) );
+			eclass.flagnames[i][sizeof( eclass.flagnames[i] ) - 1] = '\0';
+		}
+	}
+	eclass.m_modelpath = reader.readString();
+	eclass.m_skin = reader.readString();
+	for ( std::size_t count = reader.readUInt32(); count != 0 && !reader.failed(); --count )
+	{
+		const CopiedString key( reader.readString() );
+		EntityClassAttribute attribute;
+		attribute.m_type = reader.readString();
+		attribute.m_name = reader.readString();
+		attribute.m_value = reader.readString();
+		attribute.m_description = reader.readString();
+		EntityClass_insertAttribute( eclass, key.c_str(), attribute );
+	}
+	eclass.inheritanceResolved = reader.readBool();
+	eclass.sizeSpecified = reader.readBool();
+	eclass.colorSpecified = reader.readBool();
+}
+
+/// \brief Returns a copy of \p eclass that owns no shader states, suitable for keeping in the cache.
+EntityClass EntityClass_cachedCopy( const EntityClass& eclass ){
+	EntityClass copy( eclass );
+	copy.m_state_fill = 0;
+	copy.m_state_wire = 0;
+	copy.m_state_blend = 0;
+	copy.free = 0;
+	return copy;
+}
+
+const char* EntityClassCache_getPath(){
+	static StringOutputStream path( 256 );
+	path.clear();
+	path << SettingsPath_get() << "eclass.cache";
+	return path.c_str();
+}
+
+bool File_readContents( const char* path, std::vector<unsigned char>& contents ){
+	FileInputStream file( path );
+	if ( file.failed() ) {
+		return false;
+	}
+	contents.resize( file_size( path ) );
+	return contents.empty() || file.read( &contents.front(), contents.size() ) == contents.size();
+}
+
+hash_t EntityClassFile_hash( const std::vector<unsigned char>& contents ){
+	return contents.empty() ? 0 : hash_ub1( &contents.front(), contents.size() );
+}
+
+/// \brief Loads the cache written by a previous session. A cache that is truncated or was written by another version is discarded.
+void EntityClassCache_load(){
+	if ( g_entityClassCacheLoaded ) {
+		return;
+	}
+	g_entityClassCacheLoaded = true;
+
+	std::vector<unsigned char> contents;
+	if ( !File_readContents( EntityClassCache_getPath(), contents ) ) {
+		return;
+	}
+
+	EntityClassCacheReader reader( contents.empty() ? 0 : &contents.front(), contents.size() );
+	const unsigned char* magic = reader.readBytes( sizeof( c_entityClassCacheMagic ) );
+	if ( magic == 0 || memcmp( magic, c_entityClassCacheMagic, sizeof( c_entityClassCacheMagic ) ) != 0
+		 || reader.readUInt32() != c_entityClassCacheVersion ) {
+		return;
+	}
+
+	EntityClassFileRecords records;
+	for ( std::size_t count = reader.readUInt32(); count != 0 && !reader.failed(); --count )
+	{
+		const CopiedString path( reader.readString() );
+		EntityClassFileRecord& record = records[path];
+		record.m_modified = static_cast<FileTime>( reader.readUInt64() );
+		record.m_size = static_cast<FileSize>( reader.readUInt64() );
+		record.m_hash = static_cast<hash_t>( reader.readUInt64() );
+		record.m_classes.resize( reader.readUInt32() );
+		for ( std::vector<EntityClass>::iterator i = record.m_classes.begin(); i != record.m_classes.end() && !reader.failed(); ++i )
+		{
+			( *i ).m_state_fill = ( *i ).m_state_wire = ( *i ).m_state_blend = 0;
+			( *i ).free = 0;
+			EntityClass_readCached( reader, *i );
+		}
+		for ( std::size_t listCount = reader.readUInt32(); listCount != 0 && !reader.failed(); --listCount )
+		{
+			record.m_listTypes.push_back( std::pair<CopiedString, ListAttributeType>( reader.readString(), ListAttributeType() ) );
+			for ( std::size_t itemCount = reader.readUInt32(); itemCount != 0 && !reader.failed(); --itemCount )
+			{
+				const CopiedString name( reader.readString() );
+				const CopiedString value( reader.readString() );
+				record.m_listTypes.back().second.push_back( name.c_str(), value.c_str() );
+			}
+		}
+	}
+
+	if ( reader.failed() || reader.readUInt32() != c_entityClassCacheEnd ) {
+		globalErrorStream() << "EntityClass: discarding damaged cache " << makeQuoted( EntityClassCache_getPath() ) << '\n';
+		return;
+	}
+	g_entityClassCache.swap( records );
+}
+
+/// \brief Writes the cache if any definition file was parsed since it was loaded. Records for files that no longer exist are dropped.
+void EntityClassCache_save(){
+	if ( !g_entityClassCacheChanged ) {
+		return;
+	}
+	g_entityClassCacheChanged = false;
+
+	for ( EntityClassFileRecords::iterator i = g_entityClassCache.begin(); i != g_entityClassCache.end(); )
+	{
+		if ( !file_exists( ( *i ).first.c_str() ) ) {
+			g_entityClassCache.erase( i++ );
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	EntityClassCacheWriter writer;
+	writer.writeBytes( c_entityClassCacheMagic, sizeof( c_entityClassCacheMagic ) );
+	writer.writeUInt32( c_entityClassCacheVersion );
+	writer.writeUInt32( static_cast<unsigned int>( g_entityClassCache.size() ) );
+	for ( EntityClassFileRecords::const_iterator i = g_entityClassCache.begin(); i != g_entityClassCache.end(); ++i )
+	{
+		const EntityClassFileRecord& record = ( *i ).second;
+		writer.writeString( ( *i ).first.c_str() );
+		writer.writeUInt64( static_cast<unsigned long long>( record.m_modified ) );
+		writer.writeUInt64( static_cast<unsigned long long>( record.m_size ) );
+		writer.writeUInt64( static_cast<unsigned long long>( record.m_hash ) );
+		writer.writeUInt32( static_cast<unsigned int>( record.m_classes.size() ) );
+		for ( std::vector<EntityClass>::const_iterator j = record.m_classes.begin(); j != record.m_classes.end(); ++j )
+		{
+			EntityClass_writeCached( writer, *j );
+		}
+		writer.writeUInt32( static_cast<unsigned int>( record.m_listTypes.size() ) );
+		for ( std::vector<std::pair<CopiedString, ListAttributeType>>::const_iterator j = record.m_listTypes.begin(); j != record.m_listTypes.end(); ++j )
+		{
+			writer.writeString( ( *j ).first.c_str() );
+			writer.writeUInt32( static_cast<unsigned int>( ( *j ).second.end() - ( *j ).second.begin() ) );
+			for ( ListAttributeType::const_iterator k = ( *j ).second.begin(); k != ( *j ).second.end(); ++k )
+			{
+				writer.writeString( ( *k ).first.c_str() );
+				writer.writeString( ( *k ).second.c_str() );
+			}
+		}
+	}
+	writer.writeUInt32( c_entityClassCacheEnd );
+
+	// write beside the old cache and swap it in, so an interrupted write never leaves a damaged cache behind
+	StringOutputStream temporary( 256 );
+	temporary << EntityClassCache_getPath() << ".tmp";
+	{
+		FileOutputStream file( temporary.c_str() );
+		if ( file.failed() || file.write( &writer.buffer().front(), writer.buffer().size() ) != writer.buffer().size() ) {
+			globalErrorStream() << "EntityClass: failed to write cache " << makeQuoted( temporary.c_str() ) << '\n';
+			return;
+		}
+	}
+	file_remove( EntityClassCache_getPath() );
+	file_move( temporary.c_str(), EntityClassCache_getPath() );
+}
+
+/// \brief Inserts fresh copies of the classes and list types recorded for one file, as if the file had been parsed again.
+void EntityClassFileRecord_replay( const EntityClassFileRecord& record, EntityClassCollector& collector ){
+	for ( std::vector<EntityClass>::const_iterator i = record.m_classes.begin(); i != record.m_classes.end(); ++i )
+	{
+		EntityClass* e = new EntityClass( *i );
+		e->free = &Eclass_Free;
+		eclass_capture_state( e );
+		collector.insert( e );
+	}
+	for ( std::vector<std::pair<CopiedString, ListAttributeType>>::const_iterator i = record.m_listTypes.begin(); i != record.m_listTypes.end(); ++i )
+	{
+		collector.insert( ( *i ).first.c_str(), ( *i ).second );
+	}
+}
+
+/// \brief Records a copy of everything a scanner produces before passing it on.
+class RecordingEclassCollector : public EntityClassCollector
+{
+EntityClassCollector& m_collector;
+EntityClassFileRecord& m_record;
+public:
+RecordingEclassCollector( EntityClassCollector& collector, EntityClassFileRecord& record ) : m_collector( collector ), m_record( record ){
+}
+void insert( EntityClass* eclass ){
+	m_record.m_classes.push_back( EntityClass_cachedCopy( *eclass ) );
+	m_collector.insert( eclass );
+}
+void insert( const char* name, const ListAttributeType& list ){
+	m_record.m_listTypes.push_back( std::pair<CopiedString, ListAttributeType>( name, list ) );
+	m_collector.insert( name, list );
+}
+};
+
+/// \brief Loads the definitions in \p path, from the cache if the file is unchanged since it was last parsed.
+void EntityClassFile_load( const EntityClassScanner& scanner, const char* path ){
+	EntityClassCache_load();
+
+	const FileTime modified = file_modified( path );
+	const FileSize size = file_size( path );
+
+	EntityClassFileRecords::iterator i = g_entityClassCache.find( path );
+	if ( i != g_entityClassCache.end() && ( *i ).second.m_size == size ) {
+		if ( ( *i ).second.m_modified == modified ) {
+			EntityClassFileRecord_replay( ( *i ).second, g_collector );
+			return;
+		}
+		// touched but possibly not edited, e.g. by a checkout
+		std::vector<unsigned char> contents;
+		if ( File_readContents( path, contents ) && EntityClassFile_hash( contents ) == ( *i ).second.m_hash ) {
+			( *i ).second.m_modified = modified;
+			g_entityClassCacheChanged = true;
+			EntityClassFileRecord_replay( ( *i ).second, g_collector );
+			return;
+		}
+	}
+
+	std::vector<unsigned char> contents;
+	if ( !File_readContents( path, contents ) ) {
+		scanner.scanFile( g_collector, path );
+		return;
+	}
+
+	EntityClassFileRecord& record = g_entityClassCache[path];
+	record.m_modified = modified;
+	record.m_size = size;
+	record.m_hash = EntityClassFile_hash( contents );
+	record.m_classes.clear();
+	record.m_listTypes.clear();
+	RecordingEclassCollector collector( g_collector, record );
+	scanner.scanFile( collector, path );
+	g_entityClassCacheChanged = true;
+}
+
+
 class EntityClassFilterMode
 {
 public:
@@ -162,7 +604,7 @@ void operator()( const char* name ) const {
 	StringOutputStream relPath( 256 );
 	relPath << m_directory << name;
 
-	scanner.scanFile( g_collector, relPath.c_str() );
+	EntityClassFile_load( scanner, relPath.c_str() );
 }
 };
 
@@ -214,6 +656,8 @@ public:
 	};
 
 	EntityClassManager_getEClassModules().foreachModule( LoadEntityDefinitionsVisitor( baseDirectory.c_str(), gameDirectory.c_str() ) );
+
+	EntityClassCache_save();
 }
 
 EntityClass *Eclass_ForName( const char *name, bool has_brushes ){
@@ -223,9 +667,9 @@ EntityClass *Eclass_ForName( const char *name, bool has_brushes ){
 		return eclass_bad;
 	}
 
-	EntityClasses::iterator i = g_entityClasses.find( name );
-	if ( i != g_entityClasses.end() && string_equal( ( *i ).first, name ) ) {
-		return ( *i ).second;
+	EntityClassIndex::iterator i = g_entityClassIndex.find( name );
+	if ( i != g_entityClassIndex.end() ) {
+		return ( *i ).value;
 	}
 
 	EntityClass* e = EntityClass_Create_Default( name, has_brushes );
@@ -242,7 +686,10 @@ EntityClassQuake3() : m_unrealised( 4 ){
 void realise(){
 	if ( --m_unrealised == 0 ) {
 		//globalOutputStream() << "Entity Classes: realise\n";
-		EntityClassQuake3_Construct();
+		{
+			ModuleTraceScope trace( "eclass", "load entity definitions" );
+			EntityClassQuake3_Construct();
+		}
 		m_observers.realise();
 	}
 }
@@ -87,6 +87,8 @@
 #include "environment.h"
 #include "referencecache.h"
 #include "stacktrace.h"
+#include "server.h"
+#include "modulesystem.h"
 
 #if GDEF_OS_WINDOWS
 #include <windows.h>
@@ -578,11 +580,16 @@ int main( int argc, char* argv[] ){
 
 	show_splash();
 
+	ModuleServer& server = GlobalModuleServer_get();
+	server.beginTrace( "startup", "startup" );
+
 	create_global_pid();
 
 	GlobalPreferences_Init();
 
+	server.beginTrace( "startup", "select game" );
 	g_GamesDialog.Init();
+	server.endTrace();
 
 	g_strGameToolsPath = g_pGameDescription->mGameToolsPath;
 
@@ -602,15 +609,20 @@ int main( int argc, char* argv[] ){
 	}
 
 
+	server.beginTrace( "startup", "initialise modules" );
 	Radiant_Initialise();
+	server.endTrace();
 
 	user_shortcuts_init();
 
+	server.beginTrace( "startup", "create main window" );
 	g_pParentWnd = 0;
 	g_pParentWnd = new MainFrame();
+	server.endTrace();
 
 	hide_splash();
 
+	server.beginTrace( "startup", "load map" );
 	if ( mapname != NULL ) {
 		Map_LoadFile( mapname );
 	}
@@ -621,11 +633,20 @@ int main( int argc, char* argv[] ){
 	{
 		Map_New();
 	}
+	server.endTrace();
 
 	// load up shaders now that we have the map loaded
 	// eviltypeguy
+	server.beginTrace( "startup", "show startup shaders" );
 	TextureBrowser_ShowStartupShaders( GlobalTextureBrowser() );
+	server.endTrace();
 
+	server.endTrace();
+	{
+		StringOutputStream path( 256 );
+		path << SettingsPath_get() << "startup.trace.json";
+		GlobalModuleServer_writeTrace( path.c_str() );
+	}
 
 	remove_local_pid();
 
@@ -787,16 +787,34 @@ void Radiant_detachGameToolsPathObserver( ModuleObserver& observer ){
 void Radiant_Initialise(){
 	GlobalModuleServer_Initialise();
 
-	Radiant_loadModulesFromRoot( LibPath_get() );
+	{
+		ModuleTraceScope trace( "startup", "load libraries", GlobalModuleServer_get() );
+		Radiant_loadModulesFromRoot( LibPath_get() );
+	}
 
-	Preferences_Load();
+	{
+		ModuleTraceScope trace( "startup", "load preferences", GlobalModuleServer_get() );
+		Preferences_Load();
+	}
 
-	bool success = Radiant_Construct( GlobalModuleServer_get() );
-	ASSERT_MESSAGE( success, "module system failed to initialise - see radiant.log for error messages" );
+	{
+		ModuleTraceScope trace( "startup", "construct modules", GlobalModuleServer_get() );
+		bool success = Radiant_Construct( GlobalModuleServer_get() );
+		ASSERT_MESSAGE( success, "module system failed to initialise - see radiant.log for error messages" );
+	}
 
-	g_gameToolsPathObservers.realise();
-	g_gameModeObservers.realise();
-	g_gameNameObservers.realise();
+	{
+		ModuleTraceScope trace( "startup", "realise game tools path", GlobalModuleServer_get() );
+		g_gameToolsPathObservers.realise();
+	}
+	{
+		ModuleTraceScope trace( "startup", "realise game mode", GlobalModuleServer_get() );
+		g_gameModeObservers.realise();
+	}
+	{
+		ModuleTraceScope trace( "startup", "realise game name", GlobalModuleServer_get() );
+		g_gameNameObservers.realise();
+	}
 }
 
 void Radiant_Shutdown(){
@@ -1181,6 +1181,10 @@ void Map_Traverse( scene::Node& root, const scene::Traversable::Walker& walker )
 	}
 }
 
+void Map_Export( TextOutputStream& out, const MapFormat& format ){
+	format.writeGraph( GlobalSceneGraph().root(), Map_Traverse, out, g_writeMapComments );
+}
+
 class RegionExcluder : public Excluder
 {
 public:
@@ -117,6 +117,7 @@ class TextOutputStream;
 
 void Map_ImportSelected( TextInputStream& in, const MapFormat& format );
 void Map_ExportSelected( TextOutputStream& out, const MapFormat& format );
+void Map_Export( TextOutputStream& out, const MapFormat& format );
 
 bool Map_Modified( const Map& map );
 void Map_SetModified( Map& map, bool modified );
@@ -23,9 +23,11 @@
 #include "patch.h"
 
 #include <glib.h>
+#include <vector>
 #include "preferences.h"
 #include "brush_primit.h"
 #include "signal/signal.h"
+#include "os/thread.h"
 
 
 Signal0 g_patchTextureChangedCallbacks;
@@ -43,6 +45,7 @@ Shader* PatchInstance::m_state_selpoint;
 Shader* Patch::m_state_ctrl;
 Shader* Patch::m_state_lattice;
 EPatchType Patch::m_type;
+std::vector<Patch*> Patch::m_changed;
 
 
 std::size_t MAX_PATCH_WIDTH = 0;
@@ -245,13 +248,13 @@ void Patch::UpdateCachedData(){
 		m_tess.m_vertices.resize( 0 );
 		m_tess.m_arrayHeight.resize( 0 );
 		m_tess.m_arrayWidth.resize( 0 );
+		m_tessKey.m_ctrl.resize( 0 );
+		m_tessChanged = false;
+		changedErase();
 		m_aabb_local = AABB();
 		return;
 	}
 
-	BuildTesselationCurves( ROW );
-	BuildTesselationCurves( COL );
-	BuildVertexArray();
 	AccumulateBBox();
 
 	IndexBuffer ctrl_indices;
@@ -279,6 +282,16 @@ void Patch::UpdateCachedData(){
 		}
 	}
 
+	// the tesselation is built on first use, and only when its inputs differ from those it was last built from
+	m_tessChanged = !tesselationKeyEqual();
+	if ( m_tessChanged ) {
+		changedInsert();
+	}
+	else
+	{
+		changedErase();
+	}
+
 #if 0
 	{
 		Array<RenderIndex>::iterator first = m_tess.m_indices.begin();
@@ -306,6 +319,59 @@ void Patch::UpdateCachedData(){
 	SceneChangeNotify();
 }
 
+bool Patch::tesselationKeyEqual() const {
+	if ( m_tessKey.m_ctrl.size() != m_ctrlTransformed.size()
+		 || m_tessKey.m_patchDef3 != m_patchDef3
+		 || m_tessKey.m_subdivisions_x != m_subdivisions_x
+		 || m_tessKey.m_subdivisions_y != m_subdivisions_y
+		 || m_tessKey.m_threshold != g_PatchSubdivideThreshold ) {
+		return false;
+	}
+	for ( std::size_t i = 0; i != m_ctrlTransformed.size(); ++i )
+	{
+		const PatchControl& a = m_tessKey.m_ctrl[i];
+		const PatchControl& b = m_ctrlTransformed[i];
+		if ( a.m_vertex != b.m_vertex
+			 || a.m_texcoord.x() != b.m_texcoord.x()
+			 || a.m_texcoord.y() != b.m_texcoord.y() ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void Patch::buildTesselation(){
+	BuildTesselationCurves( ROW );
+	BuildTesselationCurves( COL );
+	BuildVertexArray();
+
+	m_tessKey.m_ctrl = m_ctrlTransformed;
+	m_tessKey.m_patchDef3 = m_patchDef3;
+	m_tessKey.m_subdivisions_x = m_subdivisions_x;
+	m_tessKey.m_subdivisions_y = m_subdivisions_y;
+	m_tessKey.m_threshold = g_PatchSubdivideThreshold;
+	m_tessChanged = false;
+}
+
+/// Fewest changed patches worth tesselating on more than one thread.
+const std::size_t c_patch_parallelTesselation = 64;
+
+void Patch::buildChangedTesselations(){
+	if ( m_changed.size() < c_patch_parallelTesselation ) {
+		return;
+	}
+
+	thread_run_jobs( m_changed.size(), c_patch_parallelTesselation / 4, "patch tesselation", []( std::size_t i ){
+		m_changed[i]->buildTesselation();
+	} );
+
+	for ( std::vector<Patch*>::iterator i = m_changed.begin(); i != m_changed.end(); ++i )
+	{
+		( *i )->m_changedIndex = c_patch_notChanged;
+	}
+	m_changed.clear();
+}
+
 void Patch::InvertMatrix(){
 	undoSave();
 
@@ -1490,6 +1556,7 @@ void Patch::ConstructPrefab( const AABB& aabb, EPatchPrefab eType, int axis, std
 }
 
 void Patch::RenderDebug( RenderStateFlags state ) const {
+	evaluateTesselation();
 	for ( std::size_t i = 0; i < m_tess.m_numStrips; i++ )
 	{
 		glBegin( GL_QUAD_STRIP );
@@ -1503,6 +1570,26 @@ void Patch::RenderDebug( RenderStateFlags state ) const {
 	}
 }
 
+void PatchTesselation_drawStrips( const PatchTesselation& tess ){
+	const RenderIndex* strip_indices = tess.m_indices.data();
+	if ( GlobalOpenGL().GL_1_4() && tess.m_numStrips > 1 ) {
+		static std::vector<GLsizei> counts;
+		static std::vector<const GLvoid*> indices;
+		counts.assign( tess.m_numStrips, GLsizei( tess.m_lenStrips ) );
+		indices.resize( tess.m_numStrips );
+		for ( std::size_t i = 0; i < tess.m_numStrips; i++, strip_indices += tess.m_lenStrips )
+		{
+			indices[i] = strip_indices;
+		}
+		glMultiDrawElements( GL_QUAD_STRIP, counts.data(), RenderIndexTypeID, indices.data(), GLsizei( tess.m_numStrips ) );
+		return;
+	}
+	for ( std::size_t i = 0; i < tess.m_numStrips; i++, strip_indices += tess.m_lenStrips )
+	{
+		glDrawElements( GL_QUAD_STRIP, GLsizei( tess.m_lenStrips ), RenderIndexTypeID, strip_indices );
+	}
+}
+
 void RenderablePatchSolid::RenderNormals() const {
 	const std::size_t width = m_tess.m_numStrips + 1;
 	const std::size_t height = m_tess.m_lenStrips >> 1;
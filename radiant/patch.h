@@ -44,6 +44,7 @@
 
 #include <set>
 #include <limits>
+#include <vector>
 
 #include "math/frustum.h"
 #include "string/string.h"
@@ -63,6 +64,7 @@
 #include "texturelib.h"
 #include "xml/ixml.h"
 #include "dragplanes.h"
+#include "string/pooledstring.h"
 
 enum EPatchType
 {
@@ -203,6 +205,23 @@ Array<BezierCurveTree*> m_curveTreeU;
 Array<BezierCurveTree*> m_curveTreeV;
 };
 
+/// \brief The inputs a patch tesselation was built from. Equal inputs always give an identical tesselation.
+class PatchTesselationKey
+{
+public:
+PatchTesselationKey()
+	: m_patchDef3( false ), m_subdivisions_x( 0 ), m_subdivisions_y( 0 ), m_threshold( 0 ){
+}
+Array<PatchControl> m_ctrl;
+bool m_patchDef3;
+std::size_t m_subdivisions_x;
+std::size_t m_subdivisions_y;
+int m_threshold;
+};
+
+/// \brief Draws all quad strips of \p tess from the currently bound vertex arrays, in a single call where supported.
+void PatchTesselation_drawStrips( const PatchTesselation& tess );
+
 class RenderablePatchWireframe : public OpenGLRenderable
 {
 PatchTesselation& m_tess;
@@ -310,11 +329,7 @@ void render( RenderStateFlags state ) const {
 			glTexCoordPointer( 2, GL_FLOAT, sizeof( ArbitraryMeshVertex ), &m_tess.m_vertices.data()->texcoord );
 		}
 		glVertexPointer( 3, GL_FLOAT, sizeof( ArbitraryMeshVertex ), &m_tess.m_vertices.data()->vertex );
-		const RenderIndex* strip_indices = m_tess.m_indices.data();
-		for ( std::size_t i = 0; i < m_tess.m_numStrips; i++, strip_indices += m_tess.m_lenStrips )
-		{
-			glDrawElements( GL_QUAD_STRIP, GLsizei( m_tess.m_lenStrips ), RenderIndexTypeID, strip_indices );
-		}
+		PatchTesselation_drawStrips( m_tess );
 	}
 
 #if GDEF_DEBUG
@@ -324,6 +339,8 @@ void render( RenderStateFlags state ) const {
 };
 
 // parametric surface defined by quadratic bezier control curves
+const std::size_t c_patch_notChanged = std::size_t( -1 );
+
 class Patch :
 	public XMLImporter,
 	public XMLExporter,
@@ -391,8 +408,12 @@ void release(){
 	delete this;
 }
 
+std::size_t memorySize() const {
+	return sizeof( *this ) + m_ctrl.size() * sizeof( PatchControl );
+}
+
 std::size_t m_width, m_height;
-CopiedString m_shader;
+PooledString< LazyStatic<StringPool> > m_shader;
 PatchControlArray m_ctrl;
 bool m_patchDef3;
 std::size_t m_subdivisions_x;
@@ -450,6 +471,13 @@ bool m_transformChanged;
 Callback<void()> m_evaluateTransform;
 Callback<void()> m_boundsChanged;
 
+mutable bool m_tessChanged;   // tesselation evaluation required
+std::size_t m_changedIndex;   // position in m_changed, or c_patch_notChanged
+PatchTesselationKey m_tessKey;   // inputs of the current m_tess
+
+/// Patches whose tesselation must be built before it is next used.
+static std::vector<Patch*> m_changed;
+
 void construct(){
 	m_bOverlay = false;
 	m_width = m_height = 0;
@@ -485,7 +513,9 @@ Patch( scene::Node& node, const Callback<void()>& evaluateTransform, const Callb
 	m_render_lattice( GL_LINES, m_lattice_indices, m_ctrl_vertices ),
 	m_transformChanged( false ),
 	m_evaluateTransform( evaluateTransform ),
-	m_boundsChanged( boundsChanged ){
+	m_boundsChanged( boundsChanged ),
+	m_tessChanged( false ),
+	m_changedIndex( c_patch_notChanged ){
 	construct();
 }
 Patch( const Patch& other, scene::Node& node, const Callback<void()>& evaluateTransform, const Callback<void()>& boundsChanged ) :
@@ -501,7 +531,9 @@ Patch( const Patch& other, scene::Node& node, const Callback<void()>& evaluateTr
 	m_render_lattice( GL_LINES, m_lattice_indices, m_ctrl_vertices ),
 	m_transformChanged( false ),
 	m_evaluateTransform( evaluateTransform ),
-	m_boundsChanged( boundsChanged ){
+	m_boundsChanged( boundsChanged ),
+	m_tessChanged( false ),
+	m_changedIndex( c_patch_notChanged ){
 	construct();
 
 	m_patchDef3 = other.m_patchDef3;
@@ -533,7 +565,9 @@ Patch( const Patch& other ) :
 	m_render_lattice( GL_LINES, m_lattice_indices, m_ctrl_vertices ),
 	m_transformChanged( false ),
 	m_evaluateTransform( other.m_evaluateTransform ),
-	m_boundsChanged( other.m_boundsChanged ){
+	m_boundsChanged( other.m_boundsChanged ),
+	m_tessChanged( false ),
+	m_changedIndex( c_patch_notChanged ){
 	m_bOverlay = false;
 
 	m_patchDef3 = other.m_patchDef3;
@@ -546,6 +580,7 @@ Patch( const Patch& other ) :
 }
 
 ~Patch(){
+	changedErase();
 	BezierCurveTreeArray_deleteAll( m_tess.m_curveTreeU );
 	BezierCurveTreeArray_deleteAll( m_tess.m_curveTreeV );
 
@@ -623,10 +658,12 @@ VolumeIntersectionValue intersectVolume( const VolumeTest& test, const Matrix4&
 	return test.TestAABB( m_aabb_local, localToWorld );
 }
 void render_solid( Renderer& renderer, const VolumeTest& volume, const Matrix4& localToWorld ) const {
+	evaluateTesselation();
 	renderer.SetState( m_state, Renderer::eFullMaterials );
 	renderer.addRenderable( m_render_solid, localToWorld );
 }
 void render_wireframe( Renderer& renderer, const VolumeTest& volume, const Matrix4& localToWorld ) const {
+	evaluateTesselation();
 	renderer.SetState( m_state, Renderer::eFullMaterials );
 	if ( m_patchDef3 ) {
 		renderer.addRenderable( m_render_wireframe_fixed, localToWorld );
@@ -647,6 +684,7 @@ void render_component( Renderer& renderer, const VolumeTest& volume, const Matri
 	renderer.addRenderable( m_render_ctrl, localToWorld );
 }
 void testSelect( Selector& selector, SelectionTest& test ){
+	evaluateTesselation();
 	SelectionIntersection best;
 	IndexPointer::index_type* pIndex = m_tess.m_indices.data();
 	for ( std::size_t s = 0; s < m_tess.m_numStrips; s++ )
@@ -829,6 +867,20 @@ void exportXML( XMLImporter& importer ){
 
 void UpdateCachedData();
 
+void evaluateTesselation() const {
+	if ( m_tessChanged ) {
+		buildChangedTesselations();
+		if ( m_tessChanged ) {
+			const_cast<Patch*>( this )->changedErase();
+			const_cast<Patch*>( this )->buildTesselation();
+		}
+	}
+}
+
+/// \brief Builds the tesselation of every changed patch ahead of its first use.
+/// After a bulk change such as a map load or a transform of a large selection, the tesselations are built on several threads.
+static void buildChangedTesselations();
+
 const char *GetShader() const {
 	return m_shader.c_str();
 }
@@ -917,6 +969,14 @@ void CapTexture();
 void NaturalTexture();
 void ProjectTexture( int nAxis );
 
+/// \brief Returns an estimate of the memory owned by the patch, its control points and its tesselation.
+std::size_t memorySize() const {
+	return sizeof( *this )
+		   + ( m_ctrl.size() + m_ctrlTransformed.size() + m_tessKey.m_ctrl.size() ) * sizeof( PatchControl )
+		   + m_tess.m_vertices.size() * sizeof( ArbitraryMeshVertex )
+		   + m_tess.m_indices.size() * sizeof( RenderIndex );
+}
+
 void undoSave(){
 	if ( m_map != 0 ) {
 		m_map->changed();
@@ -980,6 +1040,27 @@ void check_shader(){
 	}
 }
 
+void changedInsert(){
+	if ( m_changedIndex == c_patch_notChanged ) {
+		m_changedIndex = m_changed.size();
+		m_changed.push_back( this );
+	}
+}
+
+void changedErase(){
+	if ( m_changedIndex != c_patch_notChanged ) {
+		m_changed.back()->m_changedIndex = m_changedIndex;
+		m_changed[m_changedIndex] = m_changed.back();
+		m_changed.pop_back();
+		m_changedIndex = c_patch_notChanged;
+	}
+}
+
+bool tesselationKeyEqual() const;
+
+/// \brief Builds m_tess from the transformed control points. Touches no state outside this patch, so patches may be built concurrently.
+void buildTesselation();
+
 void InsertPoints( EMatrixMajor mt, bool bFirst );
 void RemovePoints( EMatrixMajor mt, bool bFirst );
 
@@ -1625,7 +1706,8 @@ template<typename TokenImporter, typename TokenExporter>
 class PatchNode :
 	public scene::Node::Symbiot,
 	public scene::Instantiable,
-	public scene::Cloneable
+	public scene::Cloneable,
+	public UndoMemorySize
 {
 typedef PatchNode<TokenImporter, TokenExporter> Self;
 
@@ -1636,6 +1718,7 @@ public:
 TypeCasts(){
 	NodeStaticCast<PatchNode, scene::Instantiable>::install( m_casts );
 	NodeStaticCast<PatchNode, scene::Cloneable>::install( m_casts );
+	NodeStaticCast<PatchNode, UndoMemorySize>::install( m_casts );
 	NodeContainedCast<PatchNode, Snappable>::install( m_casts );
 	NodeContainedCast<PatchNode, TransformNode>::install( m_casts );
 	NodeContainedCast<PatchNode, Patch>::install( m_casts );
@@ -1719,6 +1802,10 @@ scene::Node& clone() const {
 	return ( new PatchNode( *this ) )->node();
 }
 
+std::size_t memorySize() const {
+	return sizeof( *this ) - sizeof( Patch ) + m_patch.memorySize();
+}
+
 scene::Instance* create( const scene::Path& path, scene::Instance* parent ){
 	return new PatchInstance( path, parent, m_patch );
 }
@@ -108,7 +108,7 @@ void post( const scene::Path& path, scene::Instance& instance ) const {
 
 template<typename Functor>
 inline void Scene_forEachVisible( scene::Graph& graph, const VolumeTest& volume, const Functor& functor ){
-	graph.traverse( ForEachVisible< CullingWalker<Functor> >( volume, CullingWalker<Functor>( volume, functor ) ) );
+	graph.traverse_visible( ForEachVisible< CullingWalker<Functor> >( volume, CullingWalker<Functor>( volume, functor ) ), volume );
 }
 
 class RenderHighlighted
@@ -165,7 +165,7 @@ void post( const scene::Path& path, scene::Instance& instance, VolumeIntersectio
 };
 
 inline void Scene_Render( Renderer& renderer, const VolumeTest& volume ){
-	GlobalSceneGraph().traverse( ForEachVisible<RenderHighlighted>( volume, RenderHighlighted( renderer, volume ) ) );
+	GlobalSceneGraph().traverse_visible( ForEachVisible<RenderHighlighted>( volume, RenderHighlighted( renderer, volume ) ), volume );
 	GlobalShaderCache().forEachRenderable( RenderHighlighted::RenderCaller( RenderHighlighted( renderer, volume ) ) );
 }
 
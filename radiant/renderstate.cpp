@@ -52,6 +52,7 @@
 #include "preferences.h"
 
 #include "xywindow.h"
+#include "textures.h"
 
 
 #define DEBUG_RENDER 0
@@ -943,9 +944,10 @@ typedef std::list<OpenGLStateBucket*> Passes;
 Passes m_passes;
 IShader* m_shader;
 std::size_t m_used;
+bool m_fullResolution;
 ModuleObservers m_observers;
 public:
-OpenGLShader() : m_shader( 0 ), m_used( 0 ){
+OpenGLShader() : m_shader( 0 ), m_used( 0 ), m_fullResolution( false ){
 }
 
 ~OpenGLShader(){
@@ -958,6 +960,7 @@ void destroy(){
 		m_shader->DecRef();
 	}
 	m_shader = 0;
+	m_fullResolution = false;
 
 	for ( Passes::iterator i = m_passes.begin(); i != m_passes.end(); ++i )
 	{
@@ -967,6 +970,10 @@ void destroy(){
 }
 
 void addRenderable( const OpenGLRenderable& renderable, const Matrix4& modelview, const LightList* lights ){
+	if ( !m_fullResolution ) {
+		loadFullResolution();
+	}
+
 	for ( Passes::iterator i = m_passes.begin(); i != m_passes.end(); ++i )
 	{
 #if LIGHT_SHADER_DEBUG
@@ -997,9 +1004,26 @@ void addRenderable( const OpenGLRenderable& renderable, const Matrix4& modelview
 	}
 }
 
+/// \brief Makes sure the shader's textures are loaded at full resolution rather than as thumbnails.
+/// Done once the shader is used by something in the map or first drawn, whichever comes first.
+void loadFullResolution(){
+	if ( m_shader != 0 ) {
+		m_fullResolution = true;
+		Textures_loadFullResolution( m_shader->getTexture() );
+		Textures_loadFullResolution( m_shader->getDiffuse() );
+		Textures_loadFullResolution( m_shader->getBump() );
+		Textures_loadFullResolution( m_shader->getSpecular() );
+	}
+}
+
+void setInUse(){
+	m_shader->SetInUse( true );
+	loadFullResolution();
+}
+
 void incrementUsed(){
 	if ( ++m_used == 1 && m_shader != 0 ) {
-		m_shader->SetInUse( true );
+		setInUse();
 	}
 }
 
@@ -1031,7 +1055,7 @@ void realise( const CopiedString& name ){
 	construct( name.c_str() );
 
 	if ( m_used != 0 && m_shader != 0 ) {
-		m_shader->SetInUse( true );
+		setInUse();
 	}
 
 	for ( Passes::iterator i = m_passes.begin(); i != m_passes.end(); ++i )
@@ -1952,13 +1976,75 @@ void OpenGLState_apply( const OpenGLState& self, OpenGLState& current, unsigned
 	GlobalOpenGL_debugAssertNoErrors();
 }
 
+/// \brief Packs consecutive flat polygons that share a state and transform into one vertex array, drawn with a single multi-draw call.
+class OpenGLPolygonBatch
+{
+std::vector<Vector3> m_vertices;
+std::vector<Vector3> m_normals;
+std::vector<Vector2> m_texcoords;
+std::vector<GLint> m_first;
+std::vector<GLsizei> m_count;
+public:
+void add( const OpenGLPolygon& polygon ){
+	m_first.push_back( GLint( m_vertices.size() ) );
+	m_count.push_back( GLsizei( polygon.count ) );
+
+	const Vector3 normal( polygon.normal[0], polygon.normal[1], polygon.normal[2] );
+	const char* vertex = reinterpret_cast<const char*>( polygon.vertices );
+	const char* texcoord = reinterpret_cast<const char*>( polygon.texcoords );
+	for ( unsigned int i = 0; i != polygon.count; ++i, vertex += polygon.stride, texcoord += polygon.stride )
+	{
+		m_vertices.push_back( *reinterpret_cast<const Vector3*>( vertex ) );
+		m_texcoords.push_back( *reinterpret_cast<const Vector2*>( texcoord ) );
+		m_normals.push_back( normal );
+	}
+}
+
+/// \brief Draws and empties the batch; storage is kept for the next one.
+void flush( RenderStateFlags state ){
+	if ( m_count.empty() ) {
+		return;
+	}
+
+	glVertexPointer( 3, GL_FLOAT, sizeof( Vector3 ), m_vertices.data() );
+	if ( state & RENDER_LIGHTING ) {
+		glNormalPointer( GL_FLOAT, sizeof( Vector3 ), m_normals.data() );
+	}
+	if ( state & RENDER_TEXTURE ) {
+		glTexCoordPointer( 2, GL_FLOAT, sizeof( Vector2 ), m_texcoords.data() );
+	}
+
+	if ( GlobalOpenGL().GL_1_4() ) {
+		glMultiDrawArrays( GL_POLYGON, m_first.data(), m_count.data(), GLsizei( m_count.size() ) );
+	}
+	else
+	{
+		for ( std::size_t i = 0; i != m_count.size(); ++i )
+		{
+			glDrawArrays( GL_POLYGON, m_first[i], m_count[i] );
+		}
+	}
+
+	m_vertices.clear();
+	m_normals.clear();
+	m_texcoords.clear();
+	m_first.clear();
+	m_count.clear();
+}
+};
+
+static OpenGLPolygonBatch g_polygonBatch;
+
 void Renderables_flush( OpenGLStateBucket::Renderables& renderables, OpenGLState& current, unsigned int globalstate, const Vector3& viewer ){
 	const Matrix4* transform = 0;
+	// polygons are only merged when nothing else changes between them: no per-light parameters and no tangent-space attributes
+	const bool batchPolygons = current.m_program == 0 && ( current.m_state & RENDER_BUMP ) == 0;
 	glPushMatrix();
 	for ( OpenGLStateBucket::Renderables::const_iterator i = renderables.begin(); i != renderables.end(); ++i )
 	{
 		//qglLoadMatrixf(i->m_transform);
 		if ( !transform || ( transform != ( *i ).m_transform && !matrix4_affine_equal( *transform, *( *i ).m_transform ) ) ) {
+			g_polygonBatch.flush( current.m_state );
 			count_transform();
 			transform = ( *i ).m_transform;
 			glPopMatrix();
@@ -1969,6 +2055,15 @@ void Renderables_flush( OpenGLStateBucket::Renderables& renderables, OpenGLState
 
 		count_prim();
 
+		if ( batchPolygons ) {
+			OpenGLPolygon polygon;
+			if ( ( *i ).m_renderable->getPolygon( polygon ) ) {
+				g_polygonBatch.add( polygon );
+				continue;
+			}
+			g_polygonBatch.flush( current.m_state );
+		}
+
 		if ( current.m_program != 0 && ( *i ).m_light != 0 ) {
 			const IShader& lightShader = static_cast<OpenGLShader*>( ( *i ).m_light->getShader() )->getShader();
 			if ( lightShader.firstLayer() != 0 ) {
@@ -2014,6 +2109,7 @@ void Renderables_flush( OpenGLStateBucket::Renderables& renderables, OpenGLState
 
 		( *i ).m_renderable->render( current.m_state );
 	}
+	g_polygonBatch.flush( current.m_state );
 	glPopMatrix();
 	renderables.clear();
 }
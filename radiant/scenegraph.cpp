@@ -23,10 +23,16 @@
 
 #include "debugging/debugging.h"
 
+#include <algorithm>
 #include <map>
 #include <set>
 #include <vector>
 
+#include "cullable.h"
+#include "container/hashfunc.h"
+#include "container/hashtable.h"
+#include "math/aabb.h"
+#include "math/frustum.h"
 #include "string/string.h"
 #include "signal/signal.h"
 #include "scenelib.h"
@@ -56,31 +62,378 @@ TypeId getTypeId( const char* name ){
 }
 };
 
+/// \brief A loose octree over the world bounds of scene instances.
+/// Bounds are evaluated lazily: an instance whose bounds change is only marked dirty, and is moved to its new cell before the next query.
+class InstanceSpatialIndex
+{
+struct Node;
+
+struct Entry
+{
+	scene::Instance* m_instance;
+	Entry* m_parent;
+	Node* m_node;                  ///< 0 if the entry is in the unbounded list
+	std::vector<Entry*>* m_list;   ///< 0 until the entry has been placed
+	std::size_t m_slot;
+	std::size_t m_dirtySlot;
+	unsigned int m_stamp;
+	std::size_t m_order;           ///< position in graph order, as of the last setOrder()
+};
+
+struct Node
+{
+	AABB m_bounds;                 ///< loose bounds: twice the extents of the cell
+	Node* m_parent;
+	Node* m_children[8];
+	std::vector<Entry*> m_entries;
+	std::size_t m_count;           ///< number of entries in this node and its descendants
+
+	Node( const Vector3& origin, float extent, Node* parent )
+		: m_bounds( origin, Vector3( extent * 2, extent * 2, extent * 2 ) ), m_parent( parent ), m_count( 0 ){
+		std::fill( m_children, m_children + 8, static_cast<Node*>( 0 ) );
+	}
+	~Node(){
+		for ( Node** i = m_children; i != m_children + 8; ++i )
+		{
+			delete *i;
+		}
+	}
+};
+
+typedef std::map<scene::Instance*, Entry> Entries;
+
+static const std::size_t c_notDirty = std::size_t( -1 );
+/// half the size of the root cell; anything outside it goes to the unbounded list
+static constexpr float c_rootExtent = 131072.0f;
+static const std::size_t c_maxDepth = 9;
+
+Entries m_entries;
+Node m_root;
+std::vector<Entry*> m_unbounded;
+std::vector<Entry*> m_dirty;
+unsigned int m_stamp;
+bool m_orderChanged;
+
+Node* findNode( const AABB& aabb ){
+	const float size = std::max( aabb.extents.x(), std::max( aabb.extents.y(), aabb.extents.z() ) );
+	if ( size > c_rootExtent
+		 || std::fabs( aabb.origin.x() ) > c_rootExtent
+		 || std::fabs( aabb.origin.y() ) > c_rootExtent
+		 || std::fabs( aabb.origin.z() ) > c_rootExtent ) {
+		return 0;
+	}
+
+	Node* node = &m_root;
+	float extent = c_rootExtent;
+	for ( std::size_t depth = 0; depth != c_maxDepth; ++depth )
+	{
+		const float half = extent * 0.5f;
+		if ( size > half ) {
+			break;
+		}
+		const Vector3& centre = node->m_bounds.origin;
+		const std::size_t index = ( aabb.origin.x() >= centre.x() ? 1 : 0 )
+								  | ( aabb.origin.y() >= centre.y() ? 2 : 0 )
+								  | ( aabb.origin.z() >= centre.z() ? 4 : 0 );
+		if ( node->m_children[index] == 0 ) {
+			node->m_children[index] = new Node(
+				Vector3(
+					centre.x() + ( ( index & 1 ) ? half : -half ),
+					centre.y() + ( ( index & 2 ) ? half : -half ),
+					centre.z() + ( ( index & 4 ) ? half : -half )
+					),
+				half,
+				node
+				);
+		}
+		node = node->m_children[index];
+		extent = half;
+	}
+	return node;
+}
+
+void add( Entry& entry, Node* node ){
+	entry.m_node = node;
+	entry.m_list = ( node != 0 ) ? &node->m_entries : &m_unbounded;
+	entry.m_slot = entry.m_list->size();
+	entry.m_list->push_back( &entry );
+	for ( ; node != 0; node = node->m_parent )
+	{
+		++node->m_count;
+	}
+}
+
+void remove( Entry& entry ){
+	if ( entry.m_list == 0 ) {
+		return;
+	}
+	std::vector<Entry*>& list = *entry.m_list;
+	list[entry.m_slot] = list.back();
+	list[entry.m_slot]->m_slot = entry.m_slot;
+	list.pop_back();
+	for ( Node* node = entry.m_node; node != 0; node = node->m_parent )
+	{
+		--node->m_count;
+	}
+	entry.m_node = 0;
+	entry.m_list = 0;
+}
+
+void place( Entry& entry ){
+	const AABB& aabb = entry.m_instance->worldAABB();
+	Node* node = aabb_valid( aabb ) ? findNode( aabb ) : 0;
+	if ( entry.m_list == 0 || entry.m_node != node ) {
+		remove( entry );
+		add( entry, node );
+	}
+}
+
+void flush(){
+	for ( std::size_t i = 0; i != m_dirty.size(); ++i )
+	{
+		m_dirty[i]->m_dirtySlot = c_notDirty;
+		place( *m_dirty[i] );
+	}
+	m_dirty.clear();
+}
+
+void mark( Entry* entry, std::vector<Entry*>& visible ){
+	entry->m_stamp = m_stamp;
+	visible.push_back( entry );
+}
+
+void queryNode( const Node& node, const VolumeTest& volume, std::vector<Entry*>& visible, bool inside ){
+	if ( node.m_count == 0 ) {
+		return;
+	}
+	if ( !inside ) {
+		const VolumeIntersectionValue intersection = volume.TestAABB( node.m_bounds );
+		if ( intersection == c_volumeOutside ) {
+			return;
+		}
+		inside = intersection == c_volumeInside;
+	}
+	for ( std::vector<Entry*>::const_iterator i = node.m_entries.begin(); i != node.m_entries.end(); ++i )
+	{
+		mark( *i, visible );
+	}
+	for ( Node* const* i = node.m_children; i != node.m_children + 8; ++i )
+	{
+		if ( *i != 0 ) {
+			queryNode( **i, volume, visible, inside );
+		}
+	}
+}
+
+public:
+InstanceSpatialIndex() : m_root( Vector3( 0, 0, 0 ), c_rootExtent, 0 ), m_stamp( 0 ), m_orderChanged( false ){
+}
+
+void insert( scene::Instance* instance, scene::Instance* parent ){
+	Entry& entry = m_entries[instance];
+	Entries::iterator i = m_entries.find( parent );
+	entry.m_instance = instance;
+	entry.m_parent = ( i != m_entries.end() ) ? &( *i ).second : 0;
+	entry.m_node = 0;
+	entry.m_list = 0;
+	entry.m_dirtySlot = c_notDirty;
+	entry.m_stamp = m_stamp;
+	entry.m_order = 0;
+	m_orderChanged = true;
+	boundsChanged( entry );
+}
+
+void erase( scene::Instance* instance ){
+	Entries::iterator i = m_entries.find( instance );
+	if ( i == m_entries.end() ) {
+		return;
+	}
+	Entry& entry = ( *i ).second;
+	if ( entry.m_dirtySlot != c_notDirty ) {
+		m_dirty[entry.m_dirtySlot] = m_dirty.back();
+		m_dirty[entry.m_dirtySlot]->m_dirtySlot = entry.m_dirtySlot;
+		m_dirty.pop_back();
+	}
+	remove( entry );
+	m_entries.erase( i );
+}
+
+void boundsChanged( Entry& entry ){
+	if ( entry.m_dirtySlot == c_notDirty ) {
+		entry.m_dirtySlot = m_dirty.size();
+		m_dirty.push_back( &entry );
+	}
+}
+
+void boundsChanged( scene::Instance& instance ){
+	Entries::iterator i = m_entries.find( &instance );
+	if ( i != m_entries.end() ) {
+		boundsChanged( ( *i ).second );
+	}
+}
+
+/// \brief True if instances were inserted since setOrder() was last called.
+bool orderChanged() const {
+	return m_orderChanged;
+}
+
+/// \brief Numbers the entries in graph order, given as a range of (path, instance) pairs. query() sorts by these numbers.
+template<typename Iterator>
+void setOrder( Iterator first, Iterator last ){
+	std::size_t order = 0;
+	for ( ; first != last; ++first )
+	{
+		Entries::iterator i = m_entries.find( ( *first ).second );
+		if ( i != m_entries.end() ) {
+			( *i ).second.m_order = order++;
+		}
+	}
+	m_orderChanged = false;
+}
+
+/// \brief Appends every instance that may intersect \p volume to \p instances, together with all of its ancestors, in graph order.
+/// Returns false, and appends nothing, if no instance was culled.
+bool query( const VolumeTest& volume, std::vector<scene::Instance*>& instances ){
+	flush();
+
+	++m_stamp;
+	std::vector<Entry*> visible;
+	for ( std::vector<Entry*>::const_iterator i = m_unbounded.begin(); i != m_unbounded.end(); ++i )
+	{
+		mark( *i, visible );
+	}
+	queryNode( m_root, volume, visible, false );
+
+	// the traversal must reach each instance through its parents, even if a parent was culled on its own bounds
+	for ( std::size_t i = 0; i != visible.size(); ++i )
+	{
+		Entry* parent = visible[i]->m_parent;
+		if ( parent != 0 && parent->m_stamp != m_stamp ) {
+			mark( parent, visible );
+		}
+	}
+
+	if ( visible.size() == m_entries.size() ) {
+		return false;
+	}
+
+	std::sort( visible.begin(), visible.end(), []( const Entry* self, const Entry* other ){
+		return self->m_order < other->m_order;
+	} );
+
+	instances.reserve( instances.size() + visible.size() );
+	for ( std::vector<Entry*>::const_iterator i = visible.begin(); i != visible.end(); ++i )
+	{
+		instances.push_back( ( *i )->m_instance );
+	}
+	return true;
+}
+};
+
+/// \brief Identifies the first \c m_size nodes of a path, so that ancestors of an instance can be looked up without copying its path.
+class PathPrefix
+{
+public:
+const scene::Path* m_path;
+std::size_t m_size;
+PathPrefix() : m_path( 0 ), m_size( 0 ){
+}
+PathPrefix( const scene::Path& path, std::size_t size ) : m_path( &path ), m_size( size ){
+}
+const scene::Node* node( std::size_t index ) const {
+	return &( m_path->begin() + index )->get();
+}
+};
+
+class PathPrefixHash
+{
+public:
+typedef hash_t hash_type;
+hash_type operator()( const PathPrefix& prefix ) const {
+	hash_type hash = 0;
+	for ( std::size_t i = 0; i != prefix.m_size; ++i )
+	{
+		hash = hash_combine( pod_hash( prefix.node( i ) ), hash );
+	}
+	return hash;
+}
+};
+
+class PathPrefixEqual
+{
+public:
+bool operator()( const PathPrefix& self, const PathPrefix& other ) const {
+	if ( self.m_size != other.m_size ) {
+		return false;
+	}
+	for ( std::size_t i = self.m_size; i != 0; --i )
+	{
+		if ( self.node( i - 1 ) != other.node( i - 1 ) ) {
+			return false;
+		}
+	}
+	return true;
+}
+};
+
 class CompiledGraph : public scene::Graph, public scene::Instantiable::Observer
 {
 typedef std::map<PathConstReference, scene::Instance*> InstanceMap;
+typedef HashTable<PathPrefix, InstanceMap::iterator, PathPrefixHash, PathPrefixEqual> InstanceIndex;
 
+/// All instances in graph order, in which every subgraph is contiguous and follows its root.
+/// Kept as a tree rather than an array because walkers may insert and erase instances while traversing.
 InstanceMap m_instances;
+/// Hashed by path, for constant-time lookup of an instance and its ancestors.
+InstanceIndex m_index;
+/// The position following the most recent insertion.
+/// A subgraph is instanced in graph order, so this is where the next instance usually belongs.
+InstanceMap::iterator m_insertHint;
 scene::Instantiable::Observer* m_observer;
 Signal0 m_boundsChanged;
 scene::Path m_rootpath;
 Signal0 m_sceneChangedCallbacks;
+std::size_t m_changesDepth;
+bool m_sceneChangedHeld;
+bool m_boundsChangedHeld;
 
 TypeIdMap<NODETYPEID_MAX> m_nodeTypeIds;
 TypeIdMap<INSTANCETYPEID_MAX> m_instanceTypeIds;
 
+InstanceSpatialIndex m_spatialIndex;
+
 public:
 
 CompiledGraph( scene::Instantiable::Observer* observer )
-	: m_observer( observer ){
+	: m_insertHint( m_instances.end() ), m_observer( observer ), m_changesDepth( 0 ), m_sceneChangedHeld( false ), m_boundsChangedHeld( false ){
 }
 
 void addSceneChangedCallback( const SignalHandler& handler ){
 	m_sceneChangedCallbacks.connectLast( handler );
 }
 void sceneChanged(){
+	if ( m_changesDepth != 0 ) {
+		m_sceneChangedHeld = true;
+		return;
+	}
 	m_sceneChangedCallbacks();
 }
+void beginChanges(){
+	++m_changesDepth;
+}
+void endChanges(){
+	ASSERT_MESSAGE( m_changesDepth != 0, "scenegraph changes underflow" );
+	if ( --m_changesDepth == 0 ) {
+		if ( m_boundsChangedHeld ) {
+			m_boundsChangedHeld = false;
+			m_boundsChanged();
+		}
+		if ( m_sceneChangedHeld ) {
+			m_sceneChangedHeld = false;
+			m_sceneChangedCallbacks();
+		}
+	}
+}
 
 scene::Node& root(){
 	ASSERT_MESSAGE( !m_rootpath.empty(), "scenegraph root does not exist" );
@@ -111,6 +464,10 @@ void erase_root(){
 	root.DecRef();
 }
 void boundsChanged(){
+	if ( m_changesDepth != 0 ) {
+		m_boundsChangedHeld = true;
+		return;
+	}
 	m_boundsChanged();
 }
 
@@ -119,28 +476,85 @@ void traverse( const Walker& walker ){
 }
 
 void traverse_subgraph( const Walker& walker, const scene::Path& start ){
-	if ( !m_instances.empty() ) {
-		traverse_subgraph( walker, m_instances.find( PathConstReference( start ) ) );
+	InstanceIndex::iterator i = m_index.find( PathPrefix( start, start.size() ) );
+	if ( i != m_index.end() ) {
+		traverse_subgraph( walker, ( *i ).value );
 	}
 }
 
-scene::Instance* find( const scene::Path& path ){
-	InstanceMap::iterator i = m_instances.find( PathConstReference( path ) );
-	if ( i == m_instances.end() ) {
-		return 0;
+void traverse_visible( const Walker& walker, const VolumeTest& volume ){
+	// number the instances in graph order, in which every subgraph is contiguous and follows its root,
+	// once after each batch of insertions, so that each query sorts its hits by a plain integer
+	if ( m_spatialIndex.orderChanged() ) {
+		m_spatialIndex.setOrder( m_instances.begin(), m_instances.end() );
+	}
+
+	std::vector<scene::Instance*> instances;
+	if ( !m_spatialIndex.query( volume, instances ) ) {
+		// nothing culled: the ordered walk is cheaper than gathering every instance
+		traverse( walker );
+		return;
+	}
+
+	Stack<scene::Instance*> stack;
+	std::vector<scene::Instance*>::const_iterator i = instances.begin();
+	while ( i != instances.end() || !stack.empty() )
+	{
+		if ( i != instances.end() && stack.size() < ( *i )->path().size() ) {
+			stack.push( *i );
+			++i;
+			if ( !walker.pre( stack.top()->path(), *stack.top() ) ) {
+				// skip subgraph
+				while ( i != instances.end() && stack.size() < ( *i )->path().size() )
+				{
+					++i;
+				}
+			}
+		}
+		else
+		{
+			walker.post( stack.top()->path(), *stack.top() );
+			stack.pop();
+		}
 	}
-	return ( *i ).second;
+}
+
+scene::Instance* find( const scene::Path& path ){
+	return find( PathPrefix( path, path.size() ) );
 }
 
 void insert( scene::Instance* instance ){
-	m_instances.insert( InstanceMap::value_type( PathConstReference( instance->path() ), instance ) );
+	const scene::Path& path = instance->path();
+	InstanceMap::iterator i = m_instances.insert( m_insertHint, InstanceMap::value_type( PathConstReference( path ), instance ) );
+	m_insertHint = ++InstanceMap::iterator( i );
+	m_index.insert( PathPrefix( path, path.size() ), i );
+
+	scene::Instance* parent = 0;
+	if ( path.size() > 1 ) {
+		parent = find( PathPrefix( path, path.size() - 1 ) );
+	}
+	m_spatialIndex.insert( instance, parent );
 
 	m_observer->insert( instance );
 }
 void erase( scene::Instance* instance ){
 	m_observer->erase( instance );
 
-	m_instances.erase( PathConstReference( instance->path() ) );
+	m_spatialIndex.erase( instance );
+
+	const scene::Path& path = instance->path();
+	InstanceIndex::iterator i = m_index.find( PathPrefix( path, path.size() ) );
+	if ( i != m_index.end() ) {
+		if ( ( *i ).value == m_insertHint ) {
+			m_insertHint = m_instances.end();
+		}
+		m_instances.erase( ( *i ).value );
+		m_index.erase( i );
+	}
+}
+
+void instanceBoundsChanged( scene::Instance& instance ){
+	m_spatialIndex.boundsChanged( instance );
 }
 
 SignalHandlerId addBoundsChangedCallback( const SignalHandler& boundsChanged ){
@@ -160,6 +574,14 @@ TypeId getInstanceTypeId( const char* name ){
 
 private:
 
+scene::Instance* find( const PathPrefix& path ){
+	InstanceIndex::iterator i = m_index.find( path );
+	if ( i == m_index.end() ) {
+		return 0;
+	}
+	return ( *( *i ).value ).second;
+}
+
 bool pre( const Walker& walker, const InstanceMap::iterator& i ){
 	return walker.pre( i->first, *i->second );
 }
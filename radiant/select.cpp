@@ -265,6 +265,7 @@ void Scene_DeleteSelected( scene::Graph& graph ){
 }
 
 void Select_Delete( void ){
+	SceneChangeBatch batch;
 	Scene_DeleteSelected( GlobalSceneGraph() );
 }
 
@@ -308,6 +309,7 @@ void Scene_Invert_Selection( scene::Graph& graph ){
 }
 
 void Select_Invert(){
+	SceneChangeBatch batch;
 	Scene_Invert_Selection( GlobalSceneGraph() );
 }
 
@@ -379,6 +381,7 @@ void UpdateWorkzone_ForSelectionChanged( const Selectable& selectable ){
 }
 
 void Select_SetShader( const char* shader ){
+	SceneChangeBatch batch;
 	if ( GlobalSelectionSystem().Mode() != SelectionSystem::eComponent ) {
 		Scene_BrushSetShader_Selected( GlobalSceneGraph(), shader );
 		Scene_PatchSetShader_Selected( GlobalSceneGraph(), shader );
@@ -387,6 +390,7 @@ void Select_SetShader( const char* shader ){
 }
 
 void Select_SetTexdef( const TextureProjection& projection ){
+	SceneChangeBatch batch;
 	if ( GlobalSelectionSystem().Mode() != SelectionSystem::eComponent ) {
 		Scene_BrushSetTexdef_Selected( GlobalSceneGraph(), projection );
 	}
@@ -394,6 +398,7 @@ void Select_SetTexdef( const TextureProjection& projection ){
 }
 
 void Select_SetFlags( const ContentsFlagsValue& flags ){
+	SceneChangeBatch batch;
 	if ( GlobalSelectionSystem().Mode() != SelectionSystem::eComponent ) {
 		Scene_BrushSetFlags_Selected( GlobalSceneGraph(), flags );
 	}
@@ -535,6 +540,7 @@ void Select_RotateAxis( int axis, float deg ){
 
 
 void Select_ShiftTexture( float x, float y ){
+	SceneChangeBatch batch;
 	if ( GlobalSelectionSystem().Mode() != SelectionSystem::eComponent ) {
 		Scene_BrushShiftTexdef_Selected( GlobalSceneGraph(), x, y );
 		Scene_PatchTranslateTexture_Selected( GlobalSceneGraph(), x, y );
@@ -544,6 +550,7 @@ void Select_ShiftTexture( float x, float y ){
 }
 
 void Select_ScaleTexture( float x, float y ){
+	SceneChangeBatch batch;
 	if ( GlobalSelectionSystem().Mode() != SelectionSystem::eComponent ) {
 		Scene_BrushScaleTexdef_Selected( GlobalSceneGraph(), x, y );
 		Scene_PatchScaleTexture_Selected( GlobalSceneGraph(), x, y );
@@ -552,6 +559,7 @@ void Select_ScaleTexture( float x, float y ){
 }
 
 void Select_RotateTexture( float amt ){
+	SceneChangeBatch batch;
 	if ( GlobalSelectionSystem().Mode() != SelectionSystem::eComponent ) {
 		Scene_BrushRotateTexdef_Selected( GlobalSceneGraph(), amt );
 		Scene_PatchRotateTexture_Selected( GlobalSceneGraph(), amt );
@@ -574,6 +582,7 @@ void FindReplaceTextures( const char* pFind, const char* pReplace, bool bSelecte
 	StringOutputStream command;
 	command << "textureFindReplace -find " << pFind << " -replace " << pReplace;
 	UndoableCommand undo( command.c_str() );
+	SceneChangeBatch batch;
 
 	if ( bSelected ) {
 		if ( GlobalSelectionSystem().Mode() != SelectionSystem::eComponent ) {
@@ -651,6 +660,7 @@ void Scene_EntityGetPropertyValues( scene::Graph& graph, const char *prop, Prope
 }
 
 void Select_AllOfType(){
+	SceneChangeBatch batch;
 	if ( GlobalSelectionSystem().Mode() == SelectionSystem::eComponent ) {
 		if ( GlobalSelectionSystem().ComponentMode() == SelectionSystem::eFace ) {
 			GlobalSelectionSystem().setSelectedAllComponents( false );
@@ -678,14 +688,17 @@ void Select_AllOfType(){
 }
 
 void Select_Inside( void ){
+	SceneChangeBatch batch;
 	SelectByBounds<SelectionPolicy_Inside>::DoSelection();
 }
 
 void Select_Touching( void ){
+	SceneChangeBatch batch;
 	SelectByBounds<SelectionPolicy_Touching>::DoSelection( false );
 }
 
 void Select_FitTexture( float horizontal, float vertical ){
+	SceneChangeBatch batch;
 	if ( GlobalSelectionSystem().Mode() != SelectionSystem::eComponent ) {
 		Scene_BrushFitTexture_Selected( GlobalSceneGraph(), horizontal, vertical );
 	}
@@ -727,6 +740,7 @@ void Select_Hide(){
 }
 
 void HideSelected(){
+	SceneChangeBatch batch;
 	Select_Hide();
 	GlobalSelectionSystem().setSelectedAll( false );
 }
@@ -750,6 +764,7 @@ void Scene_Hide_All( bool hide ){
 }
 
 void Select_ShowAllHidden(){
+	SceneChangeBatch batch;
 	Scene_Hide_All( false );
 	SceneChangeNotify();
 }
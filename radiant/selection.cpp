@@ -1979,6 +1979,21 @@ void TestQuadStrip( const VertexPointer& vertices, const IndexPointer& indices,
 }
 };
 
+/// \brief A selectable that is not part of the scene, standing in for the instances of a batch of selection changes.
+class SelectableState : public Selectable
+{
+bool m_selected;
+public:
+SelectableState( bool selected ) : m_selected( selected ){
+}
+void setSelected( bool select ){
+	m_selected = select;
+}
+bool isSelected() const {
+	return m_selected;
+}
+};
+
 class SelectionCounter
 {
 public:
@@ -2559,6 +2574,9 @@ selection_t m_selection;
 selection_t m_component_selection;
 
 Signal1<const Selectable&> m_selectionChanged_callbacks;
+std::size_t m_changesDepth;
+bool m_selectionChangedHeld;
+bool m_selectedHeld;   // an instance or component was selected while the signal was held back
 
 void ConstructPivot() const;
 mutable bool m_pivotChanged;
@@ -2590,6 +2608,9 @@ RadiantSelectionSystem() :
 	m_translate_manipulator( *this, 2, 64 ),
 	m_rotate_manipulator( *this, 8, 64 ),
 	m_scale_manipulator( *this, 0, 64 ),
+	m_changesDepth( 0 ),
+	m_selectionChangedHeld( false ),
+	m_selectedHeld( false ),
 	m_pivotChanged( false ),
 	m_pivot_moving( false ){
 	SetManipulatorMode( eTranslate );
@@ -2684,11 +2705,13 @@ scene::Instance& penultimateSelected() const {
 	return *( *( --( --m_selection.end() ) ) );
 }
 void setSelectedAll( bool selected ){
+	SceneChangeBatch batch;
 	GlobalSceneGraph().traverse( select_all( selected ) );
 
 	m_manipulator->setSelected( selected );
 }
 void setSelectedAllComponents( bool selected ){
+	SceneChangeBatch batch;
 	Scene_SelectAll_Component( selected, SelectionSystem::eVertex );
 	Scene_SelectAll_Component( selected, SelectionSystem::eEdge );
 	Scene_SelectAll_Component( selected, SelectionSystem::eFace );
@@ -2715,8 +2738,26 @@ void addSelectionChangeCallback( const SelectionChangeHandler& handler ){
 	m_selectionChanged_callbacks.connectLast( handler );
 }
 void selectionChanged( const Selectable& selectable ){
+	if ( m_changesDepth != 0 ) {
+		m_selectionChangedHeld = true;
+		m_selectedHeld |= selectable.isSelected();
+		return;
+	}
 	m_selectionChanged_callbacks( selectable );
 }
+void beginChanges(){
+	++m_changesDepth;
+}
+void endChanges(){
+	ASSERT_MESSAGE( m_changesDepth != 0, "selection changes underflow" );
+	if ( --m_changesDepth == 0 && m_selectionChangedHeld ) {
+		// the instances may be gone by now, so observers are passed a stand-in carrying the combined state
+		SelectableState state( m_selectedHeld );
+		m_selectionChangedHeld = false;
+		m_selectedHeld = false;
+		m_selectionChanged_callbacks( state );
+	}
+}
 typedef MemberCaller<RadiantSelectionSystem, void(const Selectable&), &RadiantSelectionSystem::selectionChanged> SelectionChangedCaller;
 
 
@@ -3037,6 +3078,16 @@ inline RadiantSelectionSystem& getSelectionSystem(){
 }
 }
 
+SceneChangeBatch::SceneChangeBatch(){
+	GlobalSceneGraph().beginChanges();
+	getSelectionSystem().beginChanges();
+}
+
+SceneChangeBatch::~SceneChangeBatch(){
+	getSelectionSystem().endChanges();
+	GlobalSceneGraph().endChanges();
+}
+
 
 
 class testselect_entity_visible : public scene::Graph::Walker
@@ -45,6 +45,15 @@ virtual void setRectangleDrawCallback( const RectangleCallback& callback ) = 0;
 
 SelectionSystemWindowObserver* NewWindowObserver();
 
+/// \brief Holds back selection-changed, scene-changed and bounds-changed notifications while it exists, then sends each of them once.
+/// Wrap commands that select, retexture, create or delete many instances, which would otherwise notify every view and inspector once per instance.
+class SceneChangeBatch
+{
+public:
+SceneChangeBatch();
+~SceneChangeBatch();
+};
+
 class AABB;
 namespace scene
 {
@@ -27,10 +27,43 @@
 
 #include <vector>
 #include <map>
+#include <glib.h>
 #include "os/path.h"
+#include "stream/textfilestream.h"
 
 #include "modulesystem.h"
 
+/// \brief One span of the startup trace; times are in microseconds since the first span began.
+struct TraceSpan
+{
+	CopiedString m_category;
+	CopiedString m_name;
+	gint64 m_start;
+	gint64 m_duration;
+	std::size_t m_depth;
+};
+
+inline void ostream_write_json_string( TextOutputStream& ostream, const char* string ){
+	ostream << '"';
+	for ( ; *string != '\0'; ++string )
+	{
+		const unsigned char c = *string;
+		if ( c == '"' || c == '\\' ) {
+			ostream << '\\' << char( c );
+		}
+		else if ( c < 0x20 ) {
+			char escaped[8];
+			sprintf( escaped, "\\u%04x", c );
+			ostream << escaped;
+		}
+		else
+		{
+			ostream << char( c );
+		}
+	}
+	ostream << '"';
+}
+
 class RadiantModuleServer : public ModuleServer
 {
 typedef std::pair<CopiedString, int> ModuleType;
@@ -39,8 +72,15 @@ typedef std::map<ModuleKey, Module*> Modules_;
 Modules_ m_modules;
 bool m_error;
 
+typedef std::vector<TraceSpan> TraceSpans;
+TraceSpans m_trace;
+std::vector<std::size_t> m_traceOpen;
+gint64 m_traceOrigin;
+bool m_tracing;
+GThread* m_traceThread;
+
 public:
-RadiantModuleServer() : m_error( false ){
+RadiantModuleServer() : m_error( false ), m_traceOrigin( 0 ), m_tracing( true ), m_traceThread( g_thread_self() ){
 }
 
 void setError( bool error ){
@@ -86,6 +126,76 @@ void foreachModule( const char* type, int version, const Visitor& visitor ){
 		}
 	}
 }
+
+void beginTrace( const char* category, const char* name ){
+	if ( !m_tracing || g_thread_self() != m_traceThread ) {
+		return;
+	}
+	const gint64 now = g_get_monotonic_time();
+	if ( m_trace.empty() ) {
+		m_traceOrigin = now;
+	}
+	TraceSpan span;
+	span.m_category = category;
+	span.m_name = name;
+	span.m_start = now - m_traceOrigin;
+	span.m_duration = 0;
+	span.m_depth = m_traceOpen.size();
+	m_traceOpen.push_back( m_trace.size() );
+	m_trace.push_back( span );
+}
+void endTrace(){
+	if ( !m_tracing || g_thread_self() != m_traceThread ) {
+		return;
+	}
+	ASSERT_MESSAGE( !m_traceOpen.empty(), "endTrace: no span open" );
+	TraceSpan& span = m_trace[m_traceOpen.back()];
+	span.m_duration = g_get_monotonic_time() - m_traceOrigin - span.m_start;
+	m_traceOpen.pop_back();
+}
+
+/// \brief Writes the spans recorded so far to \p path in the Chrome trace event format, which chrome://tracing
+/// and most profilers can open, summarises the "startup" spans in the log and stops recording.
+void writeTrace( const char* path ){
+	ASSERT_MESSAGE( m_traceOpen.empty(), "writeTrace: span still open" );
+	m_tracing = false;
+
+	for ( TraceSpans::const_iterator i = m_trace.begin(); i != m_trace.end(); ++i )
+	{
+		if ( string_equal( ( *i ).m_category.c_str(), "startup" ) ) {
+			globalOutputStream() << "Startup: ";
+			for ( std::size_t depth = 0; depth != ( *i ).m_depth; ++depth )
+			{
+				globalOutputStream() << "  ";
+			}
+			globalOutputStream() << ( *i ).m_name.c_str() << ": " << Unsigned( ( *i ).m_duration / 1000 ) << " ms\n";
+		}
+	}
+
+	TextFileOutputStream file( path );
+	if ( file.failed() ) {
+		globalErrorStream() << "failed to write startup trace " << makeQuoted( path ) << "\n";
+	}
+	else
+	{
+		file << "{\"traceEvents\":[\n";
+		for ( TraceSpans::const_iterator i = m_trace.begin(); i != m_trace.end(); ++i )
+		{
+			if ( i != m_trace.begin() ) {
+				file << ",\n";
+			}
+			file << "{\"ph\":\"X\",\"pid\":1,\"tid\":1,\"cat\":";
+			ostream_write_json_string( file, ( *i ).m_category.c_str() );
+			file << ",\"name\":";
+			ostream_write_json_string( file, ( *i ).m_name.c_str() );
+			file << ",\"ts\":" << Unsigned( ( *i ).m_start ) << ",\"dur\":" << Unsigned( ( *i ).m_duration ) << "}";
+		}
+		file << "\n]}\n";
+		globalOutputStream() << "Startup trace written to " << makeQuoted( path ) << "\n";
+	}
+
+	TraceSpans().swap( m_trace );
+}
 };
 
 
@@ -249,9 +359,14 @@ ModuleServer& GlobalModuleServer_get(){
 }
 
 void GlobalModuleServer_loadModule( const char* filename ){
+	ModuleTraceScope trace( "library", path_get_filename_start( filename ), g_server );
 	g_libraries.registerLibrary( filename, g_server );
 }
 
+void GlobalModuleServer_writeTrace( const char* path ){
+	g_server.writeTrace( path );
+}
+
 void GlobalModuleServer_Initialise(){
 }
 
@@ -25,6 +25,8 @@
 class ModuleServer;
 ModuleServer& GlobalModuleServer_get();
 void GlobalModuleServer_loadModule( const char* filename );
+/// \brief Writes the startup trace to \p path and stops recording it.
+void GlobalModuleServer_writeTrace( const char* path );
 void GlobalModuleServer_Initialise();
 void GlobalModuleServer_Shutdown();
 
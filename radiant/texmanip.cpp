@@ -32,11 +32,9 @@
 #include "texmanip.h"
 
 #include <stdlib.h>
+#include <vector>
 #include "stream/textstream.h"
 
-static byte *row1 = NULL, *row2 = NULL;
-static int rowsize = 0;
-
 void R_ResampleTextureLerpLine( const byte *in, byte *out, int inwidth, int outwidth, int bytesperpixel ){
 	int j, xi, oldx = 0, f, fstep, endx, lerp;
 #define LERPBYTE( i ) out[i] = (byte) ( ( ( ( row2[i] - row1[i] ) * lerp ) >> 16 ) + row1[i] )
@@ -103,18 +101,10 @@ void R_ResampleTextureLerpLine( const byte *in, byte *out, int inwidth, int outw
    ================
  */
 void R_ResampleTexture( const void *indata, int inwidth, int inheight, void *outdata,  int outwidth, int outheight, int bytesperpixel ){
-	if ( rowsize < outwidth * bytesperpixel ) {
-		if ( row1 ) {
-			free( row1 );
-		}
-		if ( row2 ) {
-			free( row2 );
-		}
-
-		rowsize = outwidth * bytesperpixel;
-		row1 = (byte *)malloc( rowsize );
-		row2 = (byte *)malloc( rowsize );
-	}
+	// scratch rows owned by this call, as textures are resampled from the decode threads
+	const int rowsize = outwidth * bytesperpixel;
+	std::vector<byte> rows( 2 * rowsize );
+	byte *row1 = rows.data(), *row2 = rows.data() + rowsize;
 
 	if ( bytesperpixel == 4 ) {
 		int i, j, yi, oldy, f, fstep, lerp, endy = ( inheight - 1 ), inwidth4 = inwidth * 4, outwidth4 = outwidth * 4;
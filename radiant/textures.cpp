@@ -21,10 +21,20 @@
 
 #include "textures.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <set>
+#include <vector>
+#include <glib.h>
+
 #include "debugging/debugging.h"
 #include "warnings.h"
 
 #include "itextures.h"
+#include "iimage.h"
+#include "ifilesystem.h"
+#include "iscenegraph.h"
 #include "igl.h"
 #include "preferencesystem.h"
 #include "qgl.h"
@@ -33,11 +43,16 @@
 #include "container/hashfunc.h"
 #include "container/cache.h"
 #include "generic/callback.h"
+#include "os/file.h"
+#include "stream/filestream.h"
+#include "stream/stringstream.h"
 #include "stringio.h"
+#include "cmdlib.h"
 
 #include "image.h"
 #include "texmanip.h"
 #include "preferences.h"
+#include "mainframe.h"
 
 
 
@@ -168,12 +183,10 @@ int max_tex_size = 0;
 const int max_texture_quality = 3;
 LatchedValue<int> g_Textures_textureQuality( 3, "Texture Quality" );
 
-/// \brief This function does the actual processing of raw RGBA data into a GL texture.
-/// It will also resample to power-of-two dimensions, generate the mipmaps and adjust gamma.
-void LoadTextureRGBA( qtexture_t* q, unsigned char* pPixels, int nWidth, int nHeight ){
+/// \brief Adjusts gamma of the raw RGBA data in place and stores dimensions and average colour in \p q.
+void Texture_prepareRGBA( qtexture_t* q, unsigned char* pPixels, int nWidth, int nHeight ){
 	static float fGamma = -1;
 	float total[3];
-	byte  *outpixels = 0;
 	int nCount = nWidth * nHeight;
 
 	if ( fGamma != g_texture_globals.fGamma ) {
@@ -200,13 +213,24 @@ void LoadTextureRGBA( qtexture_t* q, unsigned char* pPixels, int nWidth, int nHe
 	q->color[0] = total[0] / ( nCount * 255 );
 	q->color[1] = total[1] / ( nCount * 255 );
 	q->color[2] = total[2] / ( nCount * 255 );
+}
 
-	glGenTextures( 1, &q->texture_number );
-
-	glBindTexture( GL_TEXTURE_2D, q->texture_number );
-
-	SetTexParameters( g_texture_mode );
+/// \brief The complete set of mip levels for one texture, stored back to back.
+class TextureMipChain
+{
+public:
+struct Level
+{
+	int width, height;
+	std::size_t offset;
+};
+std::vector<byte> m_data;
+std::vector<Level> m_levels;
+};
 
+/// \brief Resamples raw RGBA data to power-of-two dimensions, applies the quality reduction and generates the mipmaps.
+/// Touches no global state, so it may run on any thread.
+void TextureMipChain_build( TextureMipChain& mips, const unsigned char* pPixels, int nWidth, int nHeight, int quality_reduction, int max_size ){
 	int gl_width = 1;
 	while ( gl_width < nWidth )
 		gl_width <<= 1;
@@ -215,24 +239,21 @@ void LoadTextureRGBA( qtexture_t* q, unsigned char* pPixels, int nWidth, int nHe
 	while ( gl_height < nHeight )
 		gl_height <<= 1;
 
-	bool resampled = false;
+	std::vector<byte> outpixels( gl_width * gl_height * 4 );
 	if ( !( gl_width == nWidth && gl_height == nHeight ) ) {
-		resampled = true;
-		outpixels = (byte *)malloc( gl_width * gl_height * 4 );
-		R_ResampleTexture( pPixels, nWidth, nHeight, outpixels, gl_width, gl_height, 4 );
+		R_ResampleTexture( pPixels, nWidth, nHeight, &outpixels[0], gl_width, gl_height, 4 );
 	}
 	else
 	{
-		outpixels = pPixels;
+		std::copy( pPixels, pPixels + outpixels.size(), outpixels.begin() );
 	}
 
-	int quality_reduction = max_texture_quality - g_Textures_textureQuality.m_value;
-	int target_width = min_int( gl_width >> quality_reduction, max_tex_size );
-	int target_height = min_int( gl_height >> quality_reduction, max_tex_size );
+	int target_width = std::max( 1, min_int( gl_width >> quality_reduction, max_size ) );
+	int target_height = std::max( 1, min_int( gl_height >> quality_reduction, max_size ) );
 
 	while ( gl_width > target_width || gl_height > target_height )
 	{
-		GL_MipReduce( outpixels, outpixels, gl_width, gl_height, target_width, target_height );
+		GL_MipReduce( &outpixels[0], &outpixels[0], gl_width, gl_height, target_width, target_height );
 
 		if ( gl_width > target_width ) {
 			gl_width >>= 1;
@@ -242,26 +263,230 @@ void LoadTextureRGBA( qtexture_t* q, unsigned char* pPixels, int nWidth, int nHe
 		}
 	}
 
-	int mip = 0;
-	glTexImage2D( GL_TEXTURE_2D, mip++, g_texture_globals.texture_components, gl_width, gl_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, outpixels );
-	while ( gl_width > 1 || gl_height > 1 )
+	mips.m_levels.clear();
+	std::size_t size = 0;
+	for ( int width = gl_width, height = gl_height;; )
 	{
-		GL_MipReduce( outpixels, outpixels, gl_width, gl_height, 1, 1 );
-
-		if ( gl_width > 1 ) {
-			gl_width >>= 1;
+		TextureMipChain::Level level = { width, height, size };
+		mips.m_levels.push_back( level );
+		size += width * height * 4;
+		if ( width == 1 && height == 1 ) {
+			break;
 		}
-		if ( gl_height > 1 ) {
-			gl_height >>= 1;
+		if ( width > 1 ) {
+			width >>= 1;
+		}
+		if ( height > 1 ) {
+			height >>= 1;
 		}
+	}
+
+	mips.m_data.resize( size );
+	std::copy( outpixels.begin(), outpixels.begin() + gl_width * gl_height * 4, mips.m_data.begin() );
+	for ( std::size_t i = 1; i < mips.m_levels.size(); ++i )
+	{
+		const TextureMipChain::Level& level = mips.m_levels[i - 1];
+		GL_MipReduce( &mips.m_data[level.offset], &mips.m_data[mips.m_levels[i].offset], level.width, level.height, 1, 1 );
+	}
+}
 
-		glTexImage2D( GL_TEXTURE_2D, mip++, g_texture_globals.texture_components, gl_width, gl_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, outpixels );
+/// \brief Uploads every level of \p mips to the currently bound texture.
+void TextureMipChain_upload( const TextureMipChain& mips ){
+	for ( std::size_t i = 0; i < mips.m_levels.size(); ++i )
+	{
+		const TextureMipChain::Level& level = mips.m_levels[i];
+		glTexImage2D( GL_TEXTURE_2D, GLint( i ), g_texture_globals.texture_components, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, &mips.m_data[level.offset] );
 	}
+}
+
+/// \brief This function does the actual processing of raw RGBA data into a GL texture.
+/// It will also resample to power-of-two dimensions, generate the mipmaps and adjust gamma.
+void LoadTextureRGBA( qtexture_t* q, unsigned char* pPixels, int nWidth, int nHeight ){
+	Texture_prepareRGBA( q, pPixels, nWidth, nHeight );
+
+	glGenTextures( 1, &q->texture_number );
+
+	glBindTexture( GL_TEXTURE_2D, q->texture_number );
+
+	SetTexParameters( g_texture_mode );
+
+	TextureMipChain mips;
+	TextureMipChain_build( mips, pPixels, nWidth, nHeight, max_texture_quality - g_Textures_textureQuality.m_value, max_tex_size );
+	TextureMipChain_upload( mips );
 
 	glBindTexture( GL_TEXTURE_2D, 0 );
-	if ( resampled ) {
-		free( outpixels );
+}
+
+/// \brief A texture whose mipmaps are being generated by the decode threads.
+/// The GL thread owns the image and the texture pointer; a decode thread only reads the pixels and fills the mip chain.
+class TextureUpload
+{
+public:
+qtexture_t* m_texture;
+Image* m_image;
+int m_quality_reduction;
+int m_max_size;
+volatile gint m_cancelled;
+TextureMipChain m_mips;
+
+TextureUpload( qtexture_t* texture, Image* image ) :
+	m_texture( texture ),
+	m_image( image ),
+	m_quality_reduction( max_texture_quality - g_Textures_textureQuality.m_value ),
+	m_max_size( max_tex_size ),
+	m_cancelled( 0 ){
+}
+~TextureUpload(){
+	m_image->release();
+}
+void cancel(){
+	m_texture = 0;
+	g_atomic_int_set( &m_cancelled, 1 );
+}
+};
+
+typedef std::map<qtexture_t*, TextureUpload*> TextureUploads;
+
+Callback<void()> g_texturesModeChangedNotify;
+
+/// Textures showing a placeholder until their mip chain has been uploaded.
+TextureUploads g_textureUploadsPending;
+GThreadPool* g_textureDecodePool = 0;
+/// Mip chains completed by the decode threads, waiting for the GL thread.
+GAsyncQueue* g_textureUploadQueue = 0;
+guint g_textureUploadTimer = 0;
+
+/// Time the GL thread may spend uploading per frame, in microseconds.
+const gint64 c_textureUploadBudget = 8000;
+/// Interval between upload frames, in milliseconds.
+const guint c_textureUploadInterval = 16;
+
+void TextureUpload_process( gpointer data, gpointer ){
+	TextureUpload* upload = reinterpret_cast<TextureUpload*>( data );
+	if ( !g_atomic_int_get( &upload->m_cancelled ) ) {
+		TextureMipChain_build( upload->m_mips, upload->m_image->getRGBAPixels(), upload->m_image->getWidth(), upload->m_image->getHeight(), upload->m_quality_reduction, upload->m_max_size );
 	}
+	g_async_queue_push( g_textureUploadQueue, upload );
+}
+
+/// \brief Uploads finished mip chains until \p budget microseconds have elapsed.
+void Textures_flushUploads( gint64 budget ){
+	if ( !GlobalOpenGL().contextValid ) {
+		return;
+	}
+
+	bool uploaded = false;
+	const gint64 start = g_get_monotonic_time();
+	while ( TextureUpload* upload = reinterpret_cast<TextureUpload*>( g_async_queue_try_pop( g_textureUploadQueue ) ) )
+	{
+		if ( upload->m_texture != 0 ) {
+			g_textureUploadsPending.erase( upload->m_texture );
+
+			glBindTexture( GL_TEXTURE_2D, upload->m_texture->texture_number );
+			TextureMipChain_upload( upload->m_mips );
+			uploaded = true;
+		}
+		delete upload;
+
+		if ( g_get_monotonic_time() - start > budget ) {
+			break;
+		}
+	}
+
+	if ( uploaded ) {
+		glBindTexture( GL_TEXTURE_2D, 0 );
+		GlobalOpenGL_debugAssertNoErrors();
+
+		SceneChangeNotify();
+		g_texturesModeChangedNotify();
+	}
+}
+
+gboolean Textures_uploadTimeout( gpointer ){
+	Textures_flushUploads( c_textureUploadBudget );
+	if ( g_textureUploadsPending.empty() ) {
+		g_textureUploadTimer = 0;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/// \brief Hands \p image to the decode threads and gives \p texture a single texel of its average colour to show until the mipmaps are uploaded.
+/// A texture which already has a GL name keeps its current contents until then.
+/// Falls back to a synchronous upload when no decode threads are available.
+void Texture_queueUpload( qtexture_t& texture, Image* image ){
+	Texture_prepareRGBA( &texture, image->getRGBAPixels(), image->getWidth(), image->getHeight() );
+
+	const bool placeholder = texture.texture_number == 0;
+	if ( placeholder ) {
+		glGenTextures( 1, &texture.texture_number );
+		glBindTexture( GL_TEXTURE_2D, texture.texture_number );
+		SetTexParameters( g_texture_mode );
+	}
+
+	if ( g_textureDecodePool == 0 ) {
+		glBindTexture( GL_TEXTURE_2D, texture.texture_number );
+		TextureMipChain mips;
+		TextureMipChain_build( mips, image->getRGBAPixels(), image->getWidth(), image->getHeight(), max_texture_quality - g_Textures_textureQuality.m_value, max_tex_size );
+		TextureMipChain_upload( mips );
+		glBindTexture( GL_TEXTURE_2D, 0 );
+		image->release();
+		return;
+	}
+
+	if ( placeholder ) {
+		const byte colour[4] = {
+			byte( texture.color[0] * 255 ),
+			byte( texture.color[1] * 255 ),
+			byte( texture.color[2] * 255 ),
+			255,
+		};
+		glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, colour );
+		glBindTexture( GL_TEXTURE_2D, 0 );
+	}
+
+	TextureUpload* upload = new TextureUpload( &texture, image );
+	g_textureUploadsPending[&texture] = upload;
+	g_thread_pool_push( g_textureDecodePool, upload, 0 );
+
+	if ( g_textureUploadTimer == 0 ) {
+		g_textureUploadTimer = g_timeout_add( c_textureUploadInterval, Textures_uploadTimeout, 0 );
+	}
+}
+
+void Texture_cancelUpload( qtexture_t& texture ){
+	TextureUploads::iterator i = g_textureUploadsPending.find( &texture );
+	if ( i != g_textureUploadsPending.end() ) {
+		( *i ).second->cancel();
+		g_textureUploadsPending.erase( i );
+	}
+}
+
+void Textures_constructUploads(){
+	g_textureUploadQueue = g_async_queue_new();
+	g_textureDecodePool = g_thread_pool_new( TextureUpload_process, 0, std::max( 1, int( g_get_num_processors() ) - 1 ), FALSE, 0 );
+}
+
+void Textures_destroyUploads(){
+	if ( g_textureUploadTimer != 0 ) {
+		g_source_remove( g_textureUploadTimer );
+		g_textureUploadTimer = 0;
+	}
+	for ( TextureUploads::iterator i = g_textureUploadsPending.begin(); i != g_textureUploadsPending.end(); ++i )
+	{
+		( *i ).second->cancel();
+	}
+	g_textureUploadsPending.clear();
+
+	// cancelled uploads skip the mip generation, so waiting for the queued work is quick
+	g_thread_pool_free( g_textureDecodePool, FALSE, TRUE );
+	g_textureDecodePool = 0;
+	while ( TextureUpload* upload = reinterpret_cast<TextureUpload*>( g_async_queue_try_pop( g_textureUploadQueue ) ) )
+	{
+		delete upload;
+	}
+	g_async_queue_unref( g_textureUploadQueue );
+	g_textureUploadQueue = 0;
 }
 
 #if 0
@@ -331,18 +556,224 @@ const TestHashtable g_testhashtable;
 
 #endif
 
+/// \brief Persistent cache of downscaled textures, so that textures which are only browsed never need a full decode.
+/// Records are stored per game, keyed by texture name and validated against the modification time and size of the file or archive providing the image.
+bool g_Textures_thumbnailCache = true;
+
+/// Largest dimension of a cached thumbnail.
+const int c_textureThumbnailSize = 128;
+const char c_textureThumbnailMagic[4] = { 'R', 'T', 'H', 'B' };
+const unsigned int c_textureThumbnailVersion = 1;
+
+struct TextureThumbnailHeader
+{
+	char magic[4];
+	unsigned int version;
+	long long modified;
+	unsigned long long size;
+	unsigned int nameLength;
+	int width, height;
+	int thumbnailWidth, thumbnailHeight;
+	int surfaceFlags, contentFlags, value;
+};
+
+/// \brief The file or archive providing a texture image, used to validate cached thumbnails.
+struct TextureThumbnailSource
+{
+	FileTime modified;
+	FileSize size;
+};
+
+/// Textures that currently show their cached thumbnail instead of the full image.
+std::set<qtexture_t*> g_textureThumbnails;
+
+ImageModules& Textures_getImageModules();
+
+inline bool TextureKey_isDefault( const LoadImageCallback& loader ){
+	return loader == LoadImageCallback( 0, QERApp_LoadImage );
+}
+
+bool TextureThumbnail_findSource( const char* name, TextureThumbnailSource& source ){
+	class FindSourceVisitor : public ImageModules::Visitor
+	{
+	const char* m_name;
+	CopiedString& m_path;
+public:
+	FindSourceVisitor( const char* name, CopiedString& path )
+		: m_name( name ), m_path( path ){
+	}
+	void visit( const char* extension, const _QERPlugImageTable& table ) const {
+		if ( m_path.empty() ) {
+			StringOutputStream fullname( 256 );
+			fullname << m_name << '.' << extension;
+			const char* root = GlobalFileSystem().findFile( fullname.c_str() );
+			if ( !string_empty( root ) ) {
+				if ( file_is_directory( root ) ) {
+					StringOutputStream path( 256 );
+					path << root << fullname.c_str();
+					m_path = path.c_str();
+				}
+				else
+				{
+					m_path = root;
+				}
+			}
+		}
+	}
+	};
+
+	CopiedString path;
+	Textures_getImageModules().foreachModule( FindSourceVisitor( name, path ) );
+	if ( path.empty() ) {
+		return false;
+	}
+	source.modified = file_modified( path.c_str() );
+	source.size = file_size( path.c_str() );
+	return source.modified != c_invalidFileTime;
+}
+
+void TextureThumbnail_getPath( StringOutputStream& path, const char* name ){
+	char hash[16];
+	sprintf( hash, "%08x", static_cast<unsigned int>( string_hash_nocase( name ) ) );
+	path << LocalRcPath_get() << "thumbnails/" << hash << ".thumb";
+}
+
+/// \brief Reads the thumbnail of \p name into \p pixels, if the cache holds one matching \p source.
+bool TextureThumbnail_read( const char* name, const TextureThumbnailSource& source, TextureThumbnailHeader& header, std::vector<byte>& pixels ){
+	StringOutputStream path( 256 );
+	TextureThumbnail_getPath( path, name );
+	FileInputStream file( path.c_str() );
+	if ( file.failed()
+		 || file.read( reinterpret_cast<FileInputStream::byte_type*>( &header ), sizeof( header ) ) != sizeof( header )
+		 || memcmp( header.magic, c_textureThumbnailMagic, sizeof( header.magic ) ) != 0
+		 || header.version != c_textureThumbnailVersion
+		 || header.modified != static_cast<long long>( source.modified )
+		 || header.size != source.size
+		 || header.nameLength != string_length( name )
+		 || header.thumbnailWidth <= 0 || header.thumbnailWidth > c_textureThumbnailSize
+		 || header.thumbnailHeight <= 0 || header.thumbnailHeight > c_textureThumbnailSize ) {
+		return false;
+	}
+
+	std::vector<char> storedName( header.nameLength );
+	if ( header.nameLength != 0
+		 && ( file.read( reinterpret_cast<FileInputStream::byte_type*>( &storedName[0] ), header.nameLength ) != header.nameLength
+			  || !string_equal_nocase_n( &storedName[0], name, header.nameLength ) ) ) {
+		return false;
+	}
+
+	pixels.resize( header.thumbnailWidth * header.thumbnailHeight * 4 );
+	return file.read( reinterpret_cast<FileInputStream::byte_type*>( &pixels[0] ), pixels.size() ) == pixels.size();
+}
+
+/// \brief Stores a downscaled copy of \p image as the thumbnail of \p name.
+/// Must be called before gamma is applied to the image.
+void TextureThumbnail_write( const char* name, const TextureThumbnailSource& source, Image& image ){
+	const int width = image.getWidth();
+	const int height = image.getHeight();
+	if ( width <= c_textureThumbnailSize && height <= c_textureThumbnailSize ) {
+		return; // small enough to be loaded in full
+	}
+
+	TextureThumbnailHeader header;
+	memcpy( header.magic, c_textureThumbnailMagic, sizeof( header.magic ) );
+	header.version = c_textureThumbnailVersion;
+	header.modified = source.modified;
+	header.size = source.size;
+	header.nameLength = static_cast<unsigned int>( string_length( name ) );
+	header.width = width;
+	header.height = height;
+	header.thumbnailWidth = width >= height ? c_textureThumbnailSize : std::max( 1, c_textureThumbnailSize * width / height );
+	header.thumbnailHeight = height >= width ? c_textureThumbnailSize : std::max( 1, c_textureThumbnailSize * height / width );
+	header.surfaceFlags = image.getSurfaceFlags();
+	header.contentFlags = image.getContentFlags();
+	header.value = image.getValue();
+
+	std::vector<byte> pixels( header.thumbnailWidth * header.thumbnailHeight * 4 );
+	R_ResampleTexture( image.getRGBAPixels(), width, height, &pixels[0], header.thumbnailWidth, header.thumbnailHeight, 4 );
+
+	StringOutputStream path( 256 );
+	path << LocalRcPath_get() << "thumbnails/";
+	if ( !file_exists( path.c_str() ) && !Q_mkdir( path.c_str() ) ) {
+		return;
+	}
+	path.clear();
+	TextureThumbnail_getPath( path, name );
+
+	FileOutputStream file( path.c_str() );
+	if ( !file.failed() ) {
+		file.write( reinterpret_cast<const FileOutputStream::byte_type*>( &header ), sizeof( header ) );
+		file.write( reinterpret_cast<const FileOutputStream::byte_type*>( name ), header.nameLength );
+		file.write( reinterpret_cast<const FileOutputStream::byte_type*>( &pixels[0] ), pixels.size() );
+	}
+}
+
+/// \brief Gives \p texture the contents of its cached thumbnail, with the dimensions, flags and average colour of the full image.
+void Texture_realiseThumbnail( qtexture_t& texture, const TextureThumbnailHeader& header, std::vector<byte>& pixels ){
+	Texture_prepareRGBA( &texture, &pixels[0], header.thumbnailWidth, header.thumbnailHeight );
+	texture.width = header.width;
+	texture.height = header.height;
+	texture.surfaceFlags = header.surfaceFlags;
+	texture.contentFlags = header.contentFlags;
+	texture.value = header.value;
+
+	glGenTextures( 1, &texture.texture_number );
+	glBindTexture( GL_TEXTURE_2D, texture.texture_number );
+	SetTexParameters( g_texture_mode );
+
+	TextureMipChain mips;
+	TextureMipChain_build( mips, &pixels[0], header.thumbnailWidth, header.thumbnailHeight, 0, max_tex_size );
+	TextureMipChain_upload( mips );
+
+	glBindTexture( GL_TEXTURE_2D, 0 );
+
+	g_textureThumbnails.insert( &texture );
+}
+
+void Textures_loadFullResolution( qtexture_t* texture ){
+	if ( texture == 0 ) {
+		return;
+	}
+	std::set<qtexture_t*>::iterator i = g_textureThumbnails.find( texture );
+	if ( i == g_textureThumbnails.end() ) {
+		return;
+	}
+	g_textureThumbnails.erase( i );
+
+	Image* image = texture->load.loadImage( texture->name );
+	if ( image != 0 ) {
+		Texture_queueUpload( *texture, image );
+		globalOutputStream() << "Loaded Texture: \"" << texture->name << "\"\n";
+	}
+}
+
 typedef std::pair<LoadImageCallback, CopiedString> TextureKey;
 
 void qtexture_realise( qtexture_t& texture, const TextureKey& key ){
 	texture.texture_number = 0;
 	if ( !string_empty( key.second.c_str() ) ) {
+		TextureThumbnailSource source;
+		const bool thumbnail = g_Textures_thumbnailCache
+							   && TextureKey_isDefault( key.first )
+							   && TextureThumbnail_findSource( key.second.c_str(), source );
+		if ( thumbnail ) {
+			TextureThumbnailHeader header;
+			std::vector<byte> pixels;
+			if ( TextureThumbnail_read( key.second.c_str(), source, header, pixels ) ) {
+				Texture_realiseThumbnail( texture, header, pixels );
+				return;
+			}
+		}
+
 		Image* image = key.first.loadImage( key.second.c_str() );
 		if ( image != 0 ) {
-			LoadTextureRGBA( &texture, image->getRGBAPixels(), image->getWidth(), image->getHeight() );
+			if ( thumbnail ) {
+				TextureThumbnail_write( key.second.c_str(), source, *image );
+			}
 			texture.surfaceFlags = image->getSurfaceFlags();
 			texture.contentFlags = image->getContentFlags();
 			texture.value = image->getValue();
-			image->release();
+			Texture_queueUpload( texture, image );
 			globalOutputStream() << "Loaded Texture: \"" << key.second.c_str() << "\"\n";
 			GlobalOpenGL_debugAssertNoErrors();
 		}
@@ -354,6 +785,8 @@ void qtexture_realise( qtexture_t& texture, const TextureKey& key ){
 }
 
 void qtexture_unrealise( qtexture_t& texture ){
+	Texture_cancelUpload( texture );
+	g_textureThumbnails.erase( &texture );
 	if ( GlobalOpenGL().contextValid && texture.texture_number != 0 ) {
 		glDeleteTextures( 1, &texture.texture_number );
 		GlobalOpenGL_debugAssertNoErrors();
@@ -549,8 +982,6 @@ void Textures_Unrealise(){
 }
 
 
-Callback<void()> g_texturesModeChangedNotify;
-
 void Textures_setModeChangedNotify( const Callback<void()>& notify ){
 	g_texturesModeChangedNotify = notify;
 }
@@ -766,6 +1197,7 @@ void Textures_constructPreferences( PreferencesPage& page ){
             make_property<TextureCompression>(g_texture_globals.m_nTextureCompressionFormat)
 			);
 	}
+	page.appendCheckBox( "", "Cache Texture Thumbnails", g_Textures_thumbnailCache );
 }
 void Textures_constructPage( PreferenceGroup& group ){
 	PreferencesPage page( group.createPage( "Textures", "Texture Settings" ) );
@@ -788,11 +1220,13 @@ struct TextureCompressionPreference {
 
 void Textures_Construct(){
 	g_texturesmap = new TexturesMap;
+	Textures_constructUploads();
 
 	GlobalPreferenceSystem().registerPreference( "TextureCompressionFormat", make_property_string<TextureCompressionPreference>() );
 	GlobalPreferenceSystem().registerPreference( "TextureFiltering", make_property_string( reinterpret_cast<int&>( g_texture_mode ) ) );
 	GlobalPreferenceSystem().registerPreference( "TextureQuality", make_property_string( g_Textures_textureQuality.m_latched ) );
 	GlobalPreferenceSystem().registerPreference( "SI_Gamma", make_property_string( g_texture_globals.fGamma ) );
+	GlobalPreferenceSystem().registerPreference( "TextureThumbnailCache", make_property_string( g_Textures_thumbnailCache ) );
 
 	g_Textures_textureQuality.useLatched();
 
@@ -801,6 +1235,7 @@ void Textures_Construct(){
 	Textures_ModeChanged();
 }
 void Textures_Destroy(){
+	Textures_destroyUploads();
 	delete g_texturesmap;
 }
 
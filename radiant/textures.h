@@ -24,10 +24,15 @@
 
 #include "generic/callback.h"
 
+struct qtexture_t;
+
 void Textures_Realise();
 void Textures_Unrealise();
 void Textures_sharedContextDestroyed();
 
+/// \brief Replaces the cached thumbnail shown by \p texture with the full image.
+void Textures_loadFullResolution( qtexture_t* texture );
+
 void Textures_setModeChangedNotify( const Callback<void()>& notify );
 
 #endif
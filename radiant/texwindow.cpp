@@ -39,6 +39,7 @@
 #include "iarchive.h"
 #include "moduleobserver.h"
 
+#include <algorithm>
 #include <set>
 #include <string>
 #include <vector>
@@ -256,6 +257,25 @@ void TextureBrowser_enableAlpha( const Callback<void(bool)> & importer );
 
 typedef FreeCaller<void(const Callback<void(bool)> &), TextureBrowser_enableAlpha> TextureBrowserEnableAlphaExport;
 
+/// \brief A shader shown in the texture browser, and where it is drawn.
+class TextureLayoutItem
+{
+public:
+IShader* shader;
+int x, y;
+int width, height;
+};
+
+/// \brief A row of the texture browser layout, holding the items in [first, last).
+class TextureLayoutRow
+{
+public:
+int y;
+int height;
+std::size_t first;
+std::size_t last;
+};
+
 class TextureBrowser
 {
 public:
@@ -300,6 +320,10 @@ guint m_exposeHandler;
 bool m_heightChanged;
 bool m_originInvalid;
 
+// the layout of the shown shaders, rebuilt by TextureBrowser_evaluateHeight when m_heightChanged is set
+std::vector<TextureLayoutItem> m_layoutItems;
+std::vector<TextureLayoutRow> m_layoutRows;
+
 DeferredAdjustment m_scrollAdjustment;
 FreezePointer m_freezePointer;
 
@@ -597,6 +621,8 @@ void TextureBrowser_evaluateHeight( TextureBrowser& textureBrowser ){
 		textureBrowser.m_heightChanged = false;
 
 		textureBrowser.m_nTotalHeight = 0;
+		textureBrowser.m_layoutItems.clear();
+		textureBrowser.m_layoutRows.clear();
 
 		TextureLayout layout;
 		Texture_StartPos( layout );
@@ -608,13 +634,40 @@ void TextureBrowser_evaluateHeight( TextureBrowser& textureBrowser ){
 				continue;
 			}
 
-			int x, y;
-			Texture_NextPos( textureBrowser, layout, shader->getTexture(), &x, &y );
-			textureBrowser.m_nTotalHeight = std::max( textureBrowser.m_nTotalHeight, abs( layout.current_y ) + TextureBrowser_fontHeight( textureBrowser ) + textureBrowser.getTextureHeight( shader->getTexture() ) + 4 );
+			qtexture_t* q = shader->getTexture();
+			if ( !q ) {
+				break;
+			}
+
+			TextureLayoutItem item;
+			item.shader = shader;
+			Texture_NextPos( textureBrowser, layout, q, &item.x, &item.y );
+			item.width = textureBrowser.getTextureWidth( q );
+			item.height = textureBrowser.getTextureHeight( q );
+
+			const std::size_t index = textureBrowser.m_layoutItems.size();
+			if ( textureBrowser.m_layoutRows.empty() || textureBrowser.m_layoutRows.back().y != item.y ) {
+				TextureLayoutRow row = { item.y, 0, index, index };
+				textureBrowser.m_layoutRows.push_back( row );
+			}
+			TextureLayoutRow& row = textureBrowser.m_layoutRows.back();
+			row.height = std::max( row.height, item.height );
+			row.last = index + 1;
+			textureBrowser.m_layoutItems.push_back( item );
+
+			textureBrowser.m_nTotalHeight = std::max( textureBrowser.m_nTotalHeight, abs( layout.current_y ) + TextureBrowser_fontHeight( textureBrowser ) + item.height + 4 );
 		}
 	}
 }
 
+/// \brief Returns the first layout row that extends below \p y.
+std::vector<TextureLayoutRow>::const_iterator TextureBrowser_findRow( TextureBrowser& textureBrowser, int y ){
+	const int fontHeight = TextureBrowser_fontHeight( textureBrowser );
+	return std::partition_point( textureBrowser.m_layoutRows.begin(), textureBrowser.m_layoutRows.end(), [&]( const TextureLayoutRow& row ) {
+		return row.y - row.height - fontHeight >= y;
+	} );
+}
+
 int TextureBrowser_TotalHeight( TextureBrowser& textureBrowser ){
 	TextureBrowser_evaluateHeight( textureBrowser );
 	return textureBrowser.m_nTotalHeight;
@@ -983,28 +1036,18 @@ void TextureBrowser_ShowStartupShaders( TextureBrowser& textureBrowser ){
 // scroll origin so the specified texture is completely on screen
 // if current texture is not displayed, nothing is changed
 void TextureBrowser_Focus( TextureBrowser& textureBrowser, const char* name ){
-	TextureLayout layout;
-	// scroll origin so the texture is completely on screen
-	Texture_StartPos( layout );
+	TextureBrowser_evaluateHeight( textureBrowser );
 
-	for ( QERApp_ActiveShaders_IteratorBegin(); !QERApp_ActiveShaders_IteratorAtEnd(); QERApp_ActiveShaders_IteratorIncrement() )
+	// scroll origin so the texture is completely on screen
+	for ( std::vector<TextureLayoutItem>::const_iterator i = textureBrowser.m_layoutItems.begin(); i != textureBrowser.m_layoutItems.end(); ++i )
 	{
-		IShader* shader = QERApp_ActiveShaders_IteratorCurrent();
-
-		if ( !Texture_IsShown( shader, textureBrowser.m_showShaders, textureBrowser.m_hideUnused ) ) {
-			continue;
-		}
-
-		int x, y;
-		Texture_NextPos( textureBrowser, layout, shader->getTexture(), &x, &y );
-		qtexture_t* q = shader->getTexture();
-		if ( !q ) {
-			break;
-		}
+		IShader* shader = ( *i ).shader;
 
 		// we have found when texdef->name and the shader name match
 		// NOTE: as everywhere else for our comparisons, we are not case sensitive
 		if ( shader_equal( name, shader->getName() ) ) {
+			qtexture_t* q = shader->getTexture();
+			int y = ( *i ).y;
 			int textureHeight = (int)( q->height * ( (float)textureBrowser.m_textureScale / 100 ) )
 								+ 2 * TextureBrowser_fontHeight( textureBrowser );
 
@@ -1026,28 +1069,16 @@ void TextureBrowser_Focus( TextureBrowser& textureBrowser, const char* name ){
 IShader* Texture_At( TextureBrowser& textureBrowser, int mx, int my ){
 	my += TextureBrowser_getOriginY( textureBrowser ) - textureBrowser.height;
 
-	TextureLayout layout;
-	Texture_StartPos( layout );
-	for ( QERApp_ActiveShaders_IteratorBegin(); !QERApp_ActiveShaders_IteratorAtEnd(); QERApp_ActiveShaders_IteratorIncrement() )
+	TextureBrowser_evaluateHeight( textureBrowser );
+	for ( std::vector<TextureLayoutRow>::const_iterator row = TextureBrowser_findRow( textureBrowser, my ); row != textureBrowser.m_layoutRows.end() && ( *row ).y > my; ++row )
 	{
-		IShader* shader = QERApp_ActiveShaders_IteratorCurrent();
-
-		if ( !Texture_IsShown( shader, textureBrowser.m_showShaders, textureBrowser.m_hideUnused ) ) {
-			continue;
-		}
-
-		int x, y;
-		Texture_NextPos( textureBrowser, layout, shader->getTexture(), &x, &y );
-		qtexture_t  *q = shader->getTexture();
-		if ( !q ) {
-			break;
-		}
-
-		int nWidth = textureBrowser.getTextureWidth( q );
-		int nHeight = textureBrowser.getTextureHeight( q );
-		if ( mx > x && mx - x < nWidth
-			 && my < y && y - my < nHeight + TextureBrowser_fontHeight( textureBrowser ) ) {
-			return shader;
+		for ( std::size_t i = ( *row ).first; i != ( *row ).last; ++i )
+		{
+			const TextureLayoutItem& item = textureBrowser.m_layoutItems[i];
+			if ( mx > item.x && mx - item.x < item.width
+				 && my < item.y && item.y - my < item.height + TextureBrowser_fontHeight( textureBrowser ) ) {
+				return item.shader;
+			}
 		}
 	}
 
@@ -1161,33 +1192,26 @@ void Texture_Draw( TextureBrowser& textureBrowser ){
 
 	glPolygonMode( GL_FRONT_AND_BACK, GL_FILL );
 
-	int last_y = 0, last_height = 0;
-
-	TextureLayout layout;
-	Texture_StartPos( layout );
-	for ( QERApp_ActiveShaders_IteratorBegin(); !QERApp_ActiveShaders_IteratorAtEnd(); QERApp_ActiveShaders_IteratorIncrement() )
+	// only the rows in the visible scroll range are drawn
+	TextureBrowser_evaluateHeight( textureBrowser );
+	std::vector<TextureLayoutRow>::const_iterator firstRow = TextureBrowser_findRow( textureBrowser, originy );
+	std::vector<TextureLayoutRow>::const_iterator lastRow = firstRow;
+	while ( lastRow != textureBrowser.m_layoutRows.end() && ( *lastRow ).y > originy - textureBrowser.height )
 	{
-		IShader* shader = QERApp_ActiveShaders_IteratorCurrent();
-
-		if ( !Texture_IsShown( shader, textureBrowser.m_showShaders, textureBrowser.m_hideUnused ) ) {
-			continue;
-		}
-
-		int x, y;
-		Texture_NextPos( textureBrowser, layout, shader->getTexture(), &x, &y );
+		++lastRow;
+	}
+	const std::size_t first = ( firstRow != lastRow ) ? ( *firstRow ).first : 0;
+	const std::size_t last = ( firstRow != lastRow ) ? ( *( lastRow - 1 ) ).last : 0;
+	for ( std::size_t index = first; index != last; ++index )
+	{
+		const TextureLayoutItem& item = textureBrowser.m_layoutItems[index];
+		IShader* shader = item.shader;
 		qtexture_t *q = shader->getTexture();
-		if ( !q ) {
-			break;
-		}
-
-		int nWidth = textureBrowser.getTextureWidth( q );
-		int nHeight = textureBrowser.getTextureHeight( q );
 
-		if ( y != last_y ) {
-			last_y = y;
-			last_height = 0;
-		}
-		last_height = std::max( nHeight, last_height );
+		int x = item.x;
+		int y = item.y;
+		int nWidth = item.width;
+		int nHeight = item.height;
 
 		// Is this texture visible?
 		if ( ( y - nHeight - TextureBrowser_fontHeight( textureBrowser ) < originy )
@@ -1304,8 +1328,6 @@ void Texture_Draw( TextureBrowser& textureBrowser ){
 			GlobalOpenGL().drawString( name );
 			glEnable( GL_TEXTURE_2D );
 		}
-
-		//int totalHeight = abs(y) + last_height + TextureBrowser_fontHeight(textureBrowser) + 4;
 	}
 
 
@@ -1324,13 +1346,13 @@ void TextureBrowser_queueDraw( TextureBrowser& textureBrowser ){
 void TextureBrowser_setScale( TextureBrowser& textureBrowser, std::size_t scale ){
 	textureBrowser.m_textureScale = scale;
 
-	TextureBrowser_queueDraw( textureBrowser );
+	TextureBrowser_heightChanged( textureBrowser );
 }
 
 void TextureBrowser_setUniformSize( TextureBrowser& textureBrowser, std::size_t scale ){
 	textureBrowser.m_uniformTextureSize = scale;
 
-	TextureBrowser_queueDraw( textureBrowser );
+	TextureBrowser_heightChanged( textureBrowser );
 }
 
 
@@ -1511,6 +1533,10 @@ gboolean TextureBrowser_size_allocate( ui::Widget widget, GtkAllocation* allocat
 gboolean TextureBrowser_expose( ui::Widget widget, GdkEventExpose* event, TextureBrowser* textureBrowser ){
 	if ( glwidget_make_current( textureBrowser->m_gl_widget ) != FALSE ) {
 		GlobalOpenGL_debugAssertNoErrors();
+		if ( textureBrowser->m_hideUnused ) {
+			// shaders come into and out of use without notifying the browser, so lay out the (few) used shaders again
+			textureBrowser->m_heightChanged = true;
+		}
 		TextureBrowser_evaluateHeight( *textureBrowser );
 		Texture_Draw( *textureBrowser );
 		GlobalOpenGL_debugAssertNoErrors();
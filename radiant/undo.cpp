@@ -78,6 +78,9 @@ void restore(){
 void release(){
 	m_data->release();
 }
+std::size_t memorySize() const {
+	return m_data->memorySize();
+}
 };
 
 typedef std::list<StateApplicator> states_t;
@@ -105,15 +108,25 @@ void release(){
 		( *i ).release();
 	}
 }
+std::size_t memorySize() const {
+	std::size_t size = 0;
+	for ( states_t::const_iterator i = m_states.begin(); i != m_states.end(); ++i )
+	{
+		// list node: two links plus the applicator
+		size += ( *i ).memorySize() + sizeof( StateApplicator ) + 2 * sizeof( void* );
+	}
+	return size;
+}
 };
 
 struct Operation
 {
 	Snapshot m_snapshot;
 	CopiedString m_command;
+	std::size_t m_memorySize;
 
 	Operation( const char* command )
-		: m_command( command ){
+		: m_command( command ), m_memorySize( 0 ){
 	}
 	~Operation(){
 		m_snapshot.release();
@@ -128,9 +141,10 @@ typedef std::list<Operation*> Operations;
 
 Operations m_stack;
 Operation* m_pending;
+std::size_t m_memorySize;
 
 public:
-UndoStack() : m_pending( 0 ){
+UndoStack() : m_pending( 0 ), m_memorySize( 0 ){
 }
 ~UndoStack(){
 	clear();
@@ -141,6 +155,10 @@ bool empty() const {
 std::size_t size() const {
 	return m_stack.size();
 }
+/// \brief Returns the estimated memory held by all finished operations, in bytes.
+std::size_t memorySize() const {
+	return m_memorySize;
+}
 Operation* back(){
 	return m_stack.back();
 }
@@ -153,11 +171,23 @@ Operation* front(){
 const Operation* front() const {
 	return m_stack.front();
 }
+/// \brief Measures every finished operation again.
+/// Saved data can become owned by the history after its operation finishes, when a later operation removes it from the scene.
+void measure(){
+	m_memorySize = 0;
+	for ( Operations::iterator i = m_stack.begin(); i != m_stack.end(); ++i )
+	{
+		( *i )->m_memorySize = ( *i )->m_snapshot.memorySize();
+		m_memorySize += ( *i )->m_memorySize;
+	}
+}
 void pop_front(){
+	m_memorySize -= m_stack.front()->m_memorySize;
 	delete m_stack.front();
 	m_stack.pop_front();
 }
 void pop_back(){
+	m_memorySize -= m_stack.back()->m_memorySize;
 	delete m_stack.back();
 	m_stack.pop_back();
 }
@@ -169,6 +199,7 @@ void clear(){
 		}
 		m_stack.clear();
 	}
+	m_memorySize = 0;
 }
 void start( const char* command ){
 	if ( m_pending != 0 ) {
@@ -185,7 +216,11 @@ bool finish( const char* command ){
 	else
 	{
 		ASSERT_MESSAGE( !m_stack.empty(), "undo stack empty" );
-		m_stack.back()->m_command = command;
+		Operation* operation = m_stack.back();
+		operation->m_command = command;
+		// measured once the operation is complete, when it is known which saved data is no longer shared with the scene
+		operation->m_memorySize = operation->m_snapshot.memorySize();
+		m_memorySize += operation->m_memorySize;
 		return true;
 	}
 }
@@ -233,12 +268,26 @@ void mark_undoables( UndoStack* stack ){
 }
 
 std::size_t m_undo_levels;
+std::size_t m_undo_memory;
 
 typedef std::set<UndoTracker*> Trackers;
 Trackers m_trackers;
+
+/// \brief Discards the oldest undo levels until the history fits the memory budget. The most recent level is always kept.
+void trimMemory(){
+	if ( m_undo_memory == 0 ) {
+		return;
+	}
+	const std::size_t budget = m_undo_memory << 20;
+	m_undo_stack.measure();
+	while ( m_undo_stack.size() > 1 && m_undo_stack.memorySize() > budget )
+	{
+		m_undo_stack.pop_front();
+	}
+}
 public:
 RadiantUndoSystem()
-	: m_undo_levels( 64 ){
+	: m_undo_levels( 64 ), m_undo_memory( 512 ){
 }
 ~RadiantUndoSystem(){
 	clear();
@@ -267,6 +316,14 @@ void setLevels( std::size_t levels ){
 std::size_t getLevels() const {
 	return m_undo_levels;
 }
+/// \brief Sets the undo memory budget in megabytes; 0 means unlimited.
+void setMemory( std::size_t megabytes ){
+	m_undo_memory = megabytes;
+	trimMemory();
+}
+std::size_t getMemory() const {
+	return m_undo_memory;
+}
 std::size_t size() const {
 	return m_undo_stack.size();
 }
@@ -299,6 +356,7 @@ void start(){
 void finish( const char* command ){
 	if ( finishUndo( command ) ) {
 		globalOutputStream() << command << '\n';
+		trimMemory();
 	}
 }
 void undo(){
@@ -398,8 +456,19 @@ struct UndoLevels {
     }
 };
 
+struct UndoMemory {
+    static void Export(const RadiantUndoSystem &self, const Callback<void(int)> &returnz) {
+        returnz(static_cast<int>(self.getMemory()));
+    }
+
+    static void Import(RadiantUndoSystem &self, int value) {
+        self.setMemory(value < 0 ? 0 : value);
+    }
+};
+
 void Undo_constructPreferences( RadiantUndoSystem& undo, PreferencesPage& page ){
     page.appendSpinner("Undo Queue Size", 64, 0, 1024, make_property<UndoLevels>(undo));
+    page.appendSpinner("Undo Memory (MB, 0 = unlimited)", 512, 0, 16384, make_property<UndoMemory>(undo));
 }
 void Undo_constructPage( RadiantUndoSystem& undo, PreferenceGroup& group ){
 	PreferencesPage page( group.createPage( "Undo", "Undo Queue Settings" ) );
@@ -422,6 +491,7 @@ STRING_CONSTANT( Name, "*" );
 
 UndoSystemAPI(){
     GlobalPreferenceSystem().registerPreference("UndoLevels", make_property_string<UndoLevels>(m_undosystem));
+    GlobalPreferenceSystem().registerPreference("UndoMemory", make_property_string<UndoMemory>(m_undosystem));
 
 	Undo_registerPreferencesPage( m_undosystem );
 }
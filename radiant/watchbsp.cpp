@@ -174,6 +174,8 @@ bool g_WatchBSP_DoSleep = true;
 // timeout when beginning a step (in seconds)
 // if we don't get a connection quick enough we assume something failed and go back to idling
 int g_WatchBSP_Timeout = 10;
+/// Longest time, in microseconds, spent reading build messages in one monitoring tick.
+const gint64 c_watchbsp_receiveBudget = 10000;
 
 
 void Build_constructPreferences( PreferencesPage& page ){
@@ -651,108 +653,114 @@ void CWatchBSP::RoutineProcessing(){
 		}
 #endif
 
-		int ret = Net_Wait( m_pInSocket, 0, 0 );
-		if ( ret == -1 ) {
-			globalOutputStream() << "WARNING: SOCKET_ERROR in CWatchBSP::RoutineProcessing\n";
-			globalOutputStream() << "Terminating the connection.\n";
-			EndMonitoringLoop();
-			return;
-		}
+		// drain everything that has arrived, up to a time budget, instead of one message per tick
+		const gint64 deadline = g_get_monotonic_time() + c_watchbsp_receiveBudget;
+		int ret;
+		do
+		{
+			ret = Net_Wait( m_pInSocket, 0, 0 );
+			if ( ret == -1 ) {
+				globalOutputStream() << "WARNING: SOCKET_ERROR in CWatchBSP::RoutineProcessing\n";
+				globalOutputStream() << "Terminating the connection.\n";
+				EndMonitoringLoop();
+				return;
+			}
 
-		if ( ret == 1 ) {
-			// the socket has been identified, there's something (message or disconnection)
-			// see if there's anything in input
-			ret = Net_Receive( m_pInSocket, &msg );
-			if ( ret > 0 ) {
-				//        unsigned int size = msg.size; //++timo just a check
-				strcpy( m_xmlBuf, NMSG_ReadString( &msg ) );
-				if ( m_bNeedCtxtInit ) {
-					m_xmlParserCtxt = NULL;
-					m_xmlParserCtxt = xmlCreatePushParserCtxt( &saxParser, &m_message_info, m_xmlBuf, static_cast<int>( strlen( m_xmlBuf ) ), NULL );
-
-					if ( m_xmlParserCtxt == NULL ) {
-						globalErrorStream() << "Failed to create the XML parser (incoming stream began with: " << m_xmlBuf << ")\n";
-						EndMonitoringLoop();
+			if ( ret == 1 ) {
+				// the socket has been identified, there's something (message or disconnection)
+				// see if there's anything in input
+				ret = Net_Receive( m_pInSocket, &msg );
+				if ( ret > 0 ) {
+					//        unsigned int size = msg.size; //++timo just a check
+					strcpy( m_xmlBuf, NMSG_ReadString( &msg ) );
+					if ( m_bNeedCtxtInit ) {
+						m_xmlParserCtxt = NULL;
+						m_xmlParserCtxt = xmlCreatePushParserCtxt( &saxParser, &m_message_info, m_xmlBuf, static_cast<int>( strlen( m_xmlBuf ) ), NULL );
+
+						if ( m_xmlParserCtxt == NULL ) {
+							globalErrorStream() << "Failed to create the XML parser (incoming stream began with: " << m_xmlBuf << ")\n";
+							EndMonitoringLoop();
+						}
+						m_bNeedCtxtInit = false;
+					}
+					else
+					{
+						xmlParseChunk( m_xmlParserCtxt, m_xmlBuf, static_cast<int>( strlen( m_xmlBuf ) ), 0 );
 					}
-					m_bNeedCtxtInit = false;
 				}
 				else
 				{
-					xmlParseChunk( m_xmlParserCtxt, m_xmlBuf, static_cast<int>( strlen( m_xmlBuf ) ), 0 );
-				}
-			}
-			else
-			{
-				message_flush( &m_message_info );
-				// error or connection closed/reset
-				// NOTE: if we get an error down the XML stream we don't reach here
-				Net_Disconnect( m_pInSocket );
-				m_pInSocket = NULL;
-				globalOutputStream() << "Connection closed.\n";
+					message_flush( &m_message_info );
+					// error or connection closed/reset
+					// NOTE: if we get an error down the XML stream we don't reach here
+					Net_Disconnect( m_pInSocket );
+					m_pInSocket = NULL;
+					globalOutputStream() << "Connection closed.\n";
 #if 0
-				if ( m_bBSPPlugin ) {
-					EndMonitoringLoop();
-					// let the BSP plugin know that the job is done
-					g_BSPFrontendTable.m_pfnEndListen( 0 );
-					return;
-				}
+					if ( m_bBSPPlugin ) {
+						EndMonitoringLoop();
+						// let the BSP plugin know that the job is done
+						g_BSPFrontendTable.m_pfnEndListen( 0 );
+						return;
+					}
 #endif
-				// move to next step or finish
-				m_iCurrentStep++;
-				if ( m_iCurrentStep < m_pCmd->len ) {
-					DoEBeginStep();
-				}
-				else
-				{
-					// launch the engine .. OMG
-					if ( g_WatchBSP_RunQuake ) {
+					// move to next step or finish
+					m_iCurrentStep++;
+					if ( m_iCurrentStep < m_pCmd->len ) {
+						DoEBeginStep();
+					}
+					else
+					{
+						// launch the engine .. OMG
+						if ( g_WatchBSP_RunQuake ) {
 #if 0
-						// do we enter sleep mode before?
-						if ( g_WatchBSP_DoSleep ) {
-							globalOutputStream() << "Going into sleep mode..\n";
-							g_pParentWnd->OnSleep();
-						}
+							// do we enter sleep mode before?
+							if ( g_WatchBSP_DoSleep ) {
+								globalOutputStream() << "Going into sleep mode..\n";
+								g_pParentWnd->OnSleep();
+							}
 #endif
-						globalOutputStream() << "Running engine...\n";
-						StringOutputStream cmd( 256 );
-						// build the command line
-						cmd << EnginePath_get();
-						// this is game dependant
-
-						RunEngineConfiguration engineConfig;
-
-						if ( engineConfig.do_sp_mp ) {
-							if ( string_equal( gamemode_get(), "mp" ) ) {
-								cmd << engineConfig.mp_executable;
+							globalOutputStream() << "Running engine...\n";
+							StringOutputStream cmd( 256 );
+							// build the command line
+							cmd << EnginePath_get();
+							// this is game dependant
+
+							RunEngineConfiguration engineConfig;
+
+							if ( engineConfig.do_sp_mp ) {
+								if ( string_equal( gamemode_get(), "mp" ) ) {
+									cmd << engineConfig.mp_executable;
+								}
+								else
+								{
+									cmd << engineConfig.executable;
+								}
 							}
 							else
 							{
 								cmd << engineConfig.executable;
 							}
-						}
-						else
-						{
-							cmd << engineConfig.executable;
-						}
 
-						StringOutputStream cmdline;
+							StringOutputStream cmdline;
 
-						GlobalGameDescription_string_write_mapparameter( cmdline, m_sBSPName );
+							GlobalGameDescription_string_write_mapparameter( cmdline, m_sBSPName );
 
-						globalOutputStream() << cmd.c_str() << " " << cmdline.c_str() << "\n";
+							globalOutputStream() << cmd.c_str() << " " << cmdline.c_str() << "\n";
 
-						// execute now
-						if ( !Q_Exec( cmd.c_str(), (char *)cmdline.c_str(), EnginePath_get(), false, false ) ) {
-							StringOutputStream msg;
-							msg << "Failed to execute the following command: " << cmd.c_str() << cmdline.c_str();
-							globalOutputStream() << msg.c_str();
-							ui::alert( MainFrame_getWindow(), msg.c_str(), "Build monitoring", ui::alert_type::OK, ui::alert_icon::Error );
+							// execute now
+							if ( !Q_Exec( cmd.c_str(), (char *)cmdline.c_str(), EnginePath_get(), false, false ) ) {
+								StringOutputStream msg;
+								msg << "Failed to execute the following command: " << cmd.c_str() << cmdline.c_str();
+								globalOutputStream() << msg.c_str();
+								ui::alert( MainFrame_getWindow(), msg.c_str(), "Build monitoring", ui::alert_type::OK, ui::alert_icon::Error );
+							}
 						}
+						EndMonitoringLoop();
 					}
-					EndMonitoringLoop();
 				}
 			}
-		}
+		} while ( ret > 0 && m_eState == EWatching && m_pInSocket != 0 && g_get_monotonic_time() < deadline );
 	}
 	break;
 	default:
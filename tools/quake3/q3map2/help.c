@@ -235,7 +235,7 @@ void HelpLight()
 		{"-lightmapsearchpower <N>", "Optimize for lightmap merge power <N>"},
 		{"-lightmapsize <N>", "Size of lightmaps to generate (must be a power of two)"},
 		{"-lightsubdiv <N>", "Size of light emitting shader subdivision"},
-		{"-lomem", "Low memory but slower lighting mode"},
+		{"-lomem", "Low memory but slower lighting mode, also frees supersampled lightmap buffers as soon as they are no longer needed"},
 		{"-lowquality", "Low quality floodlight (appears to currently break floodlight)"},
 		{"-minsamplesize <N>", "Sets minimum lightmap resolution in luxels/qu"},
 		{"-nobouncestore", "Do not store BSP, lightmap and shader files between bounces"},
@@ -265,6 +265,7 @@ void HelpLight()
 		{"-scale <F>", "Scaling factor for all light types"},
 		{"-shadeangle <A>", "Angle for phong shading"},
 		{"-shade", "Enable phong shading at default shade angle"},
+		{"-skysamplestep <N>", "Trace sky lights (q3map_skyLight) and floodlight only every N luxels, luxels in between reuse the visibility of their neighbors"},
 		{"-skyscale <F, `-sky` F>", "Scaling factor for sky and sun light"},
 		{"-smooth", "Deprecated alias for `-samples 2`"},
 		{"-sphericalscale <F, `-spherical` F>", "Scaling factor for spherical point light entities"},
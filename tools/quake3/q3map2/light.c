@@ -189,6 +189,7 @@ static void CreateSkyLights( vec3_t color, float value, int iterations, float fi
 			sun.direction[ 1 ] = sin( angle ) * cos( elevation );
 			sun.direction[ 2 ] = sin( elevation );
 			CreateSunLight( &sun );
+			lights->flags |= LIGHT_SKY;
 
 			/* move */
 			angle += angleStep;
@@ -202,6 +203,7 @@ static void CreateSkyLights( vec3_t color, float value, int iterations, float fi
 	/* create vertical sun */
 	VectorSet( sun.direction, 0.0f, 0.0f, 1.0f );
 	CreateSunLight( &sun );
+	lights->flags |= LIGHT_SKY;
 
 	/* short circuit */
 	return;
@@ -1518,7 +1520,7 @@ typedef struct
 contribution_t;
 
 void TraceGrid( int num ){
-	int i, j, x, y, z, mod, numCon, numStyles;
+	int i, j, x, y, z, mod, numCon, numStyles, nudge;
 	float d, step;
 	vec3_t baseOrigin, cheapColor, color, thisdir;
 	rawGridPoint_t          *gp;
@@ -1558,12 +1560,12 @@ void TraceGrid( int num ){
 	if ( trace.cluster < 0 ) {
 		/* try to nudge the origin around to find a valid point */
 		VectorCopy( trace.origin, baseOrigin );
-		for ( step = 0; ( step += 0.005 ) <= 1.0; )
+		for ( step = 0, nudge = 0; ( step += 0.005 ) <= 1.0; nudge += 3 )
 		{
 			VectorCopy( baseOrigin, trace.origin );
-			trace.origin[ 0 ] += step * ( Random() - 0.5 ) * gridSize[0];
-			trace.origin[ 1 ] += step * ( Random() - 0.5 ) * gridSize[1];
-			trace.origin[ 2 ] += step * ( Random() - 0.5 ) * gridSize[2];
+			trace.origin[ 0 ] += step * ( SeededRandom( RANDOM_STREAM( RANDOM_GRID_NUDGE, num ), 0, nudge ) - 0.5 ) * gridSize[0];
+			trace.origin[ 1 ] += step * ( SeededRandom( RANDOM_STREAM( RANDOM_GRID_NUDGE, num ), 0, nudge + 1 ) - 0.5 ) * gridSize[1];
+			trace.origin[ 2 ] += step * ( SeededRandom( RANDOM_STREAM( RANDOM_GRID_NUDGE, num ), 0, nudge + 2 ) - 0.5 ) * gridSize[2];
 
 			/* ydnar: changed to find cluster num */
 			trace.cluster = ClusterForPointExt( trace.origin, VERTEX_EPSILON );
@@ -2010,6 +2012,9 @@ void LightWorld( const char *BSPFilePath, qboolean fastLightmapSearch, qboolean
 	/* ydnar: set up light envelopes */
 	SetupEnvelopes( qfalse, fast );
 
+	/* start the most expensive lightmaps first */
+	SetupRawLightmapOrder();
+
 	/* light up my world */
 	lightsPlaneCulled = 0;
 	lightsEnvelopeCulled = 0;
@@ -2017,7 +2022,7 @@ void LightWorld( const char *BSPFilePath, qboolean fastLightmapSearch, qboolean
 	lightsClusterCulled = 0;
 
 	Sys_Printf( "--- IlluminateRawLightmap ---\n" );
-	RunThreadsOnIndividual( numRawLightmaps, qtrue, IlluminateRawLightmap );
+	RunThreadsOnIndividual( numRawLightmaps, qtrue, IlluminateRawLightmapOrdered );
 	Sys_Printf( "%9d luxels illuminated\n", numLuxelsIlluminated );
 
 	StitchSurfaceLightmaps();
@@ -2041,7 +2046,7 @@ void LightWorld( const char *BSPFilePath, qboolean fastLightmapSearch, qboolean
 		qboolean storeForReal = !noBounceStore;
 
 		/* store off the bsp between bounces */
-		StoreSurfaceLightmaps( fastLightmapSearch, storeForReal );
+		StoreSurfaceLightmaps( fastLightmapSearch, storeForReal, qfalse );
 		UnparseEntities();
 
 		if ( storeForReal ) {
@@ -2084,6 +2089,9 @@ void LightWorld( const char *BSPFilePath, qboolean fastLightmapSearch, qboolean
 			Sys_FPrintf( SYS_VRB, "%9d grid points bounds culled\n", gridBoundsCulled );
 		}
 
+		/* start the most expensive lightmaps first */
+		SetupRawLightmapOrder();
+
 		/* light up my world */
 		lightsPlaneCulled = 0;
 		lightsEnvelopeCulled = 0;
@@ -2091,7 +2099,7 @@ void LightWorld( const char *BSPFilePath, qboolean fastLightmapSearch, qboolean
 		lightsClusterCulled = 0;
 
 		Sys_Printf( "--- IlluminateRawLightmap ---\n" );
-		RunThreadsOnIndividual( numRawLightmaps, qtrue, IlluminateRawLightmap );
+		RunThreadsOnIndividual( numRawLightmaps, qtrue, IlluminateRawLightmapOrdered );
 		Sys_Printf( "%9d luxels illuminated\n", numLuxelsIlluminated );
 		Sys_Printf( "%9d vertexes illuminated\n", numVertsIlluminated );
 
@@ -2113,7 +2121,7 @@ void LightWorld( const char *BSPFilePath, qboolean fastLightmapSearch, qboolean
 	}
 
 	/* ydnar: store off lightmaps */
-	StoreSurfaceLightmaps( fastLightmapSearch, qtrue );
+	StoreSurfaceLightmaps( fastLightmapSearch, qtrue, qtrue );
 }
 
 
@@ -2464,6 +2472,17 @@ int LightMain( int argc, char **argv ){
 			i++;
 		}
 
+		else if ( !strcmp( argv[ i ], "-skysamplestep" ) ) {
+			skySampleStep = atoi( argv[ i + 1 ] );
+			if ( skySampleStep < 1 ) {
+				skySampleStep = 1;
+			}
+			else if ( skySampleStep > 1 ) {
+				Sys_Printf( "Sky light and floodlight visibility traced every %d luxel(s) and interpolated in between\n", skySampleStep );
+			}
+			i++;
+		}
+
 		else if ( !strcmp( argv[ i ], "-samplessearchboxsize" ) ) {
 			lightSamplesSearchBoxSize = atoi( argv[ i + 1 ] );
 			if ( lightSamplesSearchBoxSize <= 0 ) {
@@ -69,8 +69,13 @@ void ColorToBytes( const float *color, byte *colorBytes, float scale ){
 			continue;
 		}
 
-		/* gamma */
-		sample[ i ] = pow( sample[ i ] / 255.0f, gamma ) * 255.0f;
+		/* gamma (pow( x, 1 ) is exactly x, so skip the expensive call for the default gamma) */
+		if ( gamma == 1.0f ) {
+			sample[ i ] = (double) ( sample[ i ] / 255.0f ) * 255.0f;
+		}
+		else{
+			sample[ i ] = pow( sample[ i ] / 255.0f, gamma ) * 255.0f;
+		}
 	}
 
 	if ( lightmapExposure == 0 ) {
@@ -1442,9 +1447,10 @@ void SetupDirt( void ){
 /*
    DirtForSample()
    calculates dirt value for a given sample
+   randomStream/randomIndex identify the sample for the random dirt mode
  */
 
-float DirtForSample( trace_t *trace ){
+float DirtForSample( trace_t *trace, unsigned int randomStream, unsigned int randomIndex ){
 	int i;
 	float gatherDirt, outDirt, angle, elevation, ooDepth;
 	vec3_t normal, worldUp, myUp, myRt, temp, direction, displacement;
@@ -1489,8 +1495,8 @@ float DirtForSample( trace_t *trace ){
 		for ( i = 0; i < numDirtVectors; i++ )
 		{
 			/* get random vector */
-			angle = Random() * DEG2RAD( 360.0f );
-			elevation = Random() * DEG2RAD( DIRT_CONE_ANGLE );
+			angle = SeededRandom( randomStream, randomIndex, i * 2 ) * DEG2RAD( 360.0f );
+			elevation = SeededRandom( randomStream, randomIndex, i * 2 + 1 ) * DEG2RAD( DIRT_CONE_ANGLE );
 			temp[ 0 ] = cos( angle ) * sin( elevation );
 			temp[ 1 ] = sin( angle ) * sin( elevation );
 			temp[ 2 ] = cos( elevation );
@@ -1661,7 +1667,7 @@ void DirtyRawLightmap( int rawLightmapNum ){
 			VectorCopy( normal, trace.normal );
 
 			/* get dirt */
-			*dirt = DirtForSample( &trace );
+			*dirt = DirtForSample( &trace, RANDOM_STREAM( RANDOM_LUXEL_DIRT, rawLightmapNum ), y * lm->sw + x );
 		}
 	}
 
@@ -1921,12 +1927,12 @@ static void SubsampleRawLuxel_r( rawLightmap_t *lm, trace_t *trace, vec3_t sampl
 }
 
 /* A mostly Gaussian-like bounded random distribution (sigma is expected standard deviation) */
-static void GaussLikeRandom( float sigma, float *x, float *y ){
+static void GaussLikeRandom( float sigma, unsigned int stream, unsigned int index, unsigned int sample, float *x, float *y ){
 	float r;
-	r = Random() * 2 * Q_PI;
+	r = SeededRandom( stream, index, sample * 2 ) * 2 * Q_PI;
 	*x = sigma * 2.73861278752581783822 * cos( r );
 	*y = sigma * 2.73861278752581783822 * sin( r );
-	r = Random();
+	r = SeededRandom( stream, index, sample * 2 + 1 );
 	r = 1 - sqrt( r );
 	r = 1 - sqrt( r );
 	*x *= r;
@@ -1938,7 +1944,9 @@ static void RandomSubsampleRawLuxel( rawLightmap_t *lm, trace_t *trace, vec3_t s
 	vec3_t origin, normal;
 	vec3_t total, totaldirection;
 	float dx, dy;
+	unsigned int stream;
 
+	stream = RANDOM_STREAM( RANDOM_SUBSAMPLE, lm - rawLightmaps );
 	VectorClear( total );
 	VectorClear( totaldirection );
 	mapped = 0;
@@ -1946,7 +1954,7 @@ static void RandomSubsampleRawLuxel( rawLightmap_t *lm, trace_t *trace, vec3_t s
 	{
 		/* set origin */
 		VectorCopy( sampleOrigin, origin );
-		GaussLikeRandom( bias, &dx, &dy );
+		GaussLikeRandom( bias, stream, y * lm->sw + x, b, &dx, &dy );
 
 		/* calculate position */
 		if ( !SubmapRawLuxel( lm, x, y, dx, dy, &cluster, origin, normal ) ) {
@@ -1983,6 +1991,59 @@ static void RandomSubsampleRawLuxel( rawLightmap_t *lm, trace_t *trace, vec3_t s
 
 
 
+/*
+   SkyStepLuxel()
+   with -skysamplestep, only every Nth luxel (and the last row and column) is traced for sky visibility
+ */
+
+#define SKYVIS_UNKNOWN          0
+#define SKYVIS_LIT              1
+#define SKYVIS_OCCLUDED         2
+
+static qboolean SkyStepLuxel( rawLightmap_t *lm, int step, int x, int y ){
+	return ( ( x % step ) == 0 || x == ( lm->sw - 1 ) ) && ( ( y % step ) == 0 || y == ( lm->sh - 1 ) );
+}
+
+static byte SkyVisibilityForSample( int contribution, trace_t *trace ){
+	if ( contribution < 0 ) {
+		return SKYVIS_OCCLUDED;
+	}
+	if ( contribution > 0 && VectorCompare( trace->color, trace->colorNoShadow ) ) {
+		return SKYVIS_LIT;
+	}
+	return SKYVIS_UNKNOWN;
+}
+
+/* returns the visibility shared by all mapped corner luxels, or SKYVIS_UNKNOWN if they disagree */
+static byte SkyStepVisibility( rawLightmap_t *lm, byte *skyVis, int step, int x, int y ){
+	int t, sx, sy, x0, y0, x1, y1;
+	byte vis, cornerVis;
+
+
+	x0 = x - ( x % step );
+	y0 = y - ( y % step );
+	x1 = ( x0 + step ) < lm->sw ? x0 + step : lm->sw - 1;
+	y1 = ( y0 + step ) < lm->sh ? y0 + step : lm->sh - 1;
+
+	vis = SKYVIS_UNKNOWN;
+	for ( t = 0; t < 4; t++ )
+	{
+		sx = ( t & 1 ) ? x1 : x0;
+		sy = ( t & 2 ) ? y1 : y0;
+		if ( *SUPER_CLUSTER( sx, sy ) < 0 ) {
+			continue;
+		}
+		cornerVis = skyVis[ sy * lm->sw + sx ];
+		if ( cornerVis == SKYVIS_UNKNOWN || ( vis != SKYVIS_UNKNOWN && cornerVis != vis ) ) {
+			return SKYVIS_UNKNOWN;
+		}
+		vis = cornerVis;
+	}
+	return vis;
+}
+
+
+
 /*
    IlluminateRawLightmap()
    illuminates the luxels
@@ -1993,9 +2054,10 @@ static void RandomSubsampleRawLuxel( rawLightmap_t *lm, trace_t *trace, vec3_t s
 #define LIGHT_DELUXEL( x, y )       ( lightDeluxels + ( ( ( ( y ) * lm->sw ) + ( x ) ) * SUPER_DELUXEL_SIZE ) )
 
 void IlluminateRawLightmap( int rawLightmapNum ){
-	int i, t, x, y, sx, sy, size, luxelFilterRadius, lightmapNum;
+	int i, t, x, y, sx, sy, size, luxelFilterRadius, lightmapNum, skyStep, contribution;
 	int                 *cluster, *cluster2, mapped, lighted, totalLighted;
 	size_t llSize, ldSize;
+	byte                *skyVis;
 	rawLightmap_t       *lm;
 	surfaceInfo_t       *info;
 	qboolean filterColor, filterDir;
@@ -2130,6 +2192,12 @@ void IlluminateRawLightmap( int rawLightmapNum ){
 		else{
 			lightDeluxels = NULL;
 		}
+		if ( skySampleStep > 1 ) {
+			skyVis = safe_malloc( lm->sw * lm->sh );
+		}
+		else{
+			skyVis = NULL;
+		}
 
 		/* clear luxels */
 		//%	memset( lm->superLuxels[ 0 ], 0, llSize );
@@ -2233,11 +2301,19 @@ void IlluminateRawLightmap( int rawLightmapNum ){
 				memset( (void *) lm->superFlags, 0, size );
 			}
 
+			/* sky lights only trace a coarse grid of luxels in the initial pass */
+			skyStep = ( skyVis != NULL && ( trace.light->flags & LIGHT_SKY ) ) ? skySampleStep : 1;
+
 			/* initial pass, one sample per luxel */
 			for ( y = 0; y < lm->sh; y++ )
 			{
 				for ( x = 0; x < lm->sw; x++ )
 				{
+					/* luxels between the sky steps are handled below */
+					if ( skyStep > 1 && !SkyStepLuxel( lm, skyStep, x, y ) ) {
+						continue;
+					}
+
 					/* get cluster */
 					cluster = SUPER_CLUSTER( x, y );
 					if ( *cluster < 0 ) {
@@ -2260,9 +2336,14 @@ void IlluminateRawLightmap( int rawLightmapNum ){
 					VectorCopy( normal, trace.normal );
 
 					/* get light for this sample */
-					LightContributionToSample( &trace );
+					contribution = LightContributionToSample( &trace );
 					VectorCopy( trace.color, lightLuxel );
 
+					/* remember the sky visibility for the luxels in between */
+					if ( skyStep > 1 ) {
+						skyVis[ y * lm->sw + x ] = SkyVisibilityForSample( contribution, &trace );
+					}
+
 					/* add the contribution to the deluxemap */
 					if ( deluxemap ) {
 						VectorCopy( trace.directionContribution, lightDeluxel );
@@ -2280,6 +2361,77 @@ void IlluminateRawLightmap( int rawLightmapNum ){
 				}
 			}
 
+			/* sky step pass, luxels whose traced neighbors agree on the sky visibility skip the trace */
+			if ( skyStep > 1 ) {
+				for ( y = 0; y < lm->sh; y++ )
+				{
+					for ( x = 0; x < lm->sw; x++ )
+					{
+						/* already traced */
+						if ( SkyStepLuxel( lm, skyStep, x, y ) ) {
+							continue;
+						}
+
+						/* get cluster */
+						cluster = SUPER_CLUSTER( x, y );
+						if ( *cluster < 0 ) {
+							continue;
+						}
+
+						/* get particulars */
+						lightLuxel = LIGHT_LUXEL( x, y );
+						lightDeluxel = LIGHT_DELUXEL( x, y );
+						origin = SUPER_ORIGIN( x, y );
+						normal = SUPER_NORMAL( x, y );
+						flag = SUPER_FLAG( x, y );
+
+						/* set contribution count */
+						lightLuxel[ 3 ] = 1.0f;
+
+						/* setup trace */
+						trace.cluster = *cluster;
+						VectorCopy( origin, trace.origin );
+						VectorCopy( normal, trace.normal );
+
+						/* get light for this sample */
+						switch ( SkyStepVisibility( lm, skyVis, skyStep, x, y ) )
+						{
+						case SKYVIS_OCCLUDED:
+							VectorClear( trace.color );
+							VectorClear( trace.directionContribution );
+							trace.forceSubsampling = 0.0f;
+							break;
+
+						case SKYVIS_LIT:
+							trace.testOcclusion = qfalse;
+							LightContributionToSample( &trace );
+							trace.testOcclusion = !noTrace;
+							break;
+
+						default:
+							LightContributionToSample( &trace );
+							break;
+						}
+						VectorCopy( trace.color, lightLuxel );
+
+						/* add the contribution to the deluxemap */
+						if ( deluxemap ) {
+							VectorCopy( trace.directionContribution, lightDeluxel );
+						}
+
+						/* check for evilness */
+						if ( trace.forceSubsampling > 1.0f && ( lightSamples > 1 || lightRandomSamples ) && luxelFilterRadius == 0 ) {
+							totalLighted++;
+							*flag |= FLAG_FORCE_SUBSAMPLING; /* force */
+						}
+						/* add to count */
+						else if ( trace.color[ 0 ] || trace.color[ 1 ] || trace.color[ 2 ] ) {
+							totalLighted++;
+						}
+					}
+				}
+			}
+
 			/* don't even bother with everything else if nothing was lit */
 			if ( totalLighted == 0 ) {
 				continue;
@@ -2543,11 +2695,21 @@ void IlluminateRawLightmap( int rawLightmapNum ){
 		if ( deluxemap ) {
 			free( lightDeluxels );
 		}
+
+		if ( skyVis != NULL ) {
+			free( skyVis );
+		}
 	}
 
 	/* free light list */
 	FreeTraceLights( &trace );
 
+	/* sampling flags are rebuilt for every light, so don't keep them around in lomem mode */
+	if ( loMem && lm->superFlags != NULL ) {
+		free( lm->superFlags );
+		lm->superFlags = NULL;
+	}
+
 	/* floodlight pass */
 	if ( floodlighty ) {
 		FloodlightIlluminateLightmap( lm );
@@ -2729,6 +2891,79 @@ void IlluminateRawLightmap( int rawLightmapNum ){
 
 
 
+/*
+   SetupRawLightmapOrder()
+   sorts the raw lightmaps by estimated cost (supersampled luxels * lights reaching them)
+   so IlluminateRawLightmapOrdered() starts the longest lightmaps first and threads don't idle at the end of a pass
+ */
+
+static int *rawLightmapOrder = NULL;
+static float *rawLightmapCosts = NULL;
+
+static void EstimateRawLightmapCost( int rawLightmapNum ){
+	rawLightmap_t       *lm;
+	trace_t trace;
+
+
+	/* get lightmap */
+	lm = &rawLightmaps[ rawLightmapNum ];
+
+	/* no lights, only the luxel count matters */
+	if ( numLights == 0 ) {
+		rawLightmapCosts[ rawLightmapNum ] = (float) lm->sw * lm->sh;
+		return;
+	}
+
+	/* count the lights the same way IlluminateRawLightmap() culls them */
+	memset( &trace, 0, sizeof( trace ) );
+	trace.twoSided = qfalse;
+	CreateTraceLightsForBounds( lm->mins, lm->maxs, lm->plane, lm->numLightClusters, lm->lightClusters, LIGHT_SURFACES, &trace );
+	rawLightmapCosts[ rawLightmapNum ] = (float) lm->sw * lm->sh * ( trace.numLights + 1 );
+	FreeTraceLights( &trace );
+}
+
+static int CompareRawLightmapCost( const void *a, const void *b ){
+	int an, bn;
+
+
+	an = *( (const int*) a );
+	bn = *( (const int*) b );
+
+	/* most expensive first */
+	if ( rawLightmapCosts[ an ] > rawLightmapCosts[ bn ] ) {
+		return -1;
+	}
+	if ( rawLightmapCosts[ an ] < rawLightmapCosts[ bn ] ) {
+		return 1;
+	}
+	return an - bn;
+}
+
+void SetupRawLightmapOrder( void ){
+	int i;
+
+
+	/* allocate */
+	if ( rawLightmapOrder == NULL ) {
+		rawLightmapOrder = safe_malloc( numRawLightmaps * sizeof( int ) );
+		rawLightmapCosts = safe_malloc( numRawLightmaps * sizeof( float ) );
+	}
+
+	/* estimate (the light lists change between bounces) */
+	RunThreadsOnIndividual( numRawLightmaps, qfalse, EstimateRawLightmapCost );
+
+	/* sort */
+	for ( i = 0; i < numRawLightmaps; i++ )
+		rawLightmapOrder[ i ] = i;
+	qsort( rawLightmapOrder, numRawLightmaps, sizeof( int ), CompareRawLightmapCost );
+}
+
+void IlluminateRawLightmapOrdered( int num ){
+	IlluminateRawLightmap( rawLightmapOrder != NULL ? rawLightmapOrder[ num ] : num );
+}
+
+
+
 /*
    IlluminateVertexes()
    light the surface vertexes
@@ -2823,7 +3058,7 @@ void IlluminateVertexes( int num ){
 
 					/* r7 dirt */
 					if ( dirty && !bouncing ) {
-						dirt = DirtForSample( &trace );
+						dirt = DirtForSample( &trace, RANDOM_STREAM( RANDOM_VERTEX_DIRT, num ), i );
 					}
 					else{
 						dirt = 1.0f;
@@ -2888,7 +3123,7 @@ void IlluminateVertexes( int num ){
 
 								/* r7 dirt */
 								if ( dirty && !bouncing ) {
-									dirt = DirtForSample( &trace );
+									dirt = DirtForSample( &trace, RANDOM_STREAM( RANDOM_VERTEX_DIRT, num ), i );
 								}
 								else{
 									dirt = 1.0f;
@@ -4258,8 +4493,8 @@ float FloodLightForSample( trace_t *trace, float floodLightDistance, qboolean fl
 
 // floodlight pass on a lightmap
 void FloodLightRawLightmapPass( rawLightmap_t *lm, vec3_t lmFloodLightRGB, float lmFloodLightIntensity, float lmFloodLightDistance, qboolean lmFloodLightLowQuality, float floodlightDirectionScale ){
-	int i, x, y, *cluster;
-	float               *origin, *normal, *floodlight, floodLightAmount;
+	int i, t, x, y, sx, sy, x0, y0, x1, y1, *cluster;
+	float               *origin, *normal, *floodlight, floodLightAmount, *floodAmounts, weight, totalWeight;
 	surfaceInfo_t       *info;
 	trace_t trace;
 	// int sx, sy;
@@ -4292,6 +4527,14 @@ void FloodLightRawLightmapPass( rawLightmap_t *lm, vec3_t lmFloodLightRGB, float
 		}
 	}
 
+	/* allocate floodlight map storage on first use */
+	if ( lm->superFloodLight == NULL ) {
+		lm->superFloodLight = safe_malloc0( lm->sw * lm->sh * SUPER_FLOODLIGHT_SIZE * sizeof( float ) );
+	}
+
+	/* -skysamplestep keeps the traced amounts around to interpolate the luxels in between */
+	floodAmounts = skySampleStep > 1 ? safe_malloc( lm->sw * lm->sh * sizeof( float ) ) : NULL;
+
 	/* gather floodlight */
 	for ( y = 0; y < lm->sh; y++ )
 	{
@@ -4311,6 +4554,11 @@ void FloodLightRawLightmapPass( rawLightmap_t *lm, vec3_t lmFloodLightRGB, float
 				continue;
 			}
 
+			/* luxels between the sky steps are handled below */
+			if ( floodAmounts != NULL && !SkyStepLuxel( lm, skySampleStep, x, y ) ) {
+				continue;
+			}
+
 			/* copy to trace */
 			trace.cluster = *cluster;
 			VectorCopy( origin, trace.origin );
@@ -4318,6 +4566,9 @@ void FloodLightRawLightmapPass( rawLightmap_t *lm, vec3_t lmFloodLightRGB, float
 
 			/* get floodlight */
 			floodLightAmount = FloodLightForSample( &trace, lmFloodLightDistance, lmFloodLightLowQuality ) * lmFloodLightIntensity;
+			if ( floodAmounts != NULL ) {
+				floodAmounts[ y * lm->sw + x ] = floodLightAmount;
+			}
 
 			/* add floodlight */
 			floodlight[0] += lmFloodLightRGB[0] * floodLightAmount;
@@ -4327,6 +4578,74 @@ void FloodLightRawLightmapPass( rawLightmap_t *lm, vec3_t lmFloodLightRGB, float
 		}
 	}
 
+	/* sky step pass, bilinearly interpolate the traced neighbors facing the same way */
+	if ( floodAmounts != NULL ) {
+		for ( y = 0; y < lm->sh; y++ )
+		{
+			for ( x = 0; x < lm->sw; x++ )
+			{
+				/* get luxel */
+				cluster = SUPER_CLUSTER( x, y );
+				if ( *cluster < 0 || SkyStepLuxel( lm, skySampleStep, x, y ) ) {
+					continue;
+				}
+				origin = SUPER_ORIGIN( x, y );
+				normal = SUPER_NORMAL( x, y );
+				floodlight = SUPER_FLOODLIGHT( x, y );
+
+				/* get the traced corners */
+				x0 = x - ( x % skySampleStep );
+				y0 = y - ( y % skySampleStep );
+				x1 = ( x0 + skySampleStep ) < lm->sw ? x0 + skySampleStep : lm->sw - 1;
+				y1 = ( y0 + skySampleStep ) < lm->sh ? y0 + skySampleStep : lm->sh - 1;
+
+				floodLightAmount = 0.0f;
+				totalWeight = 0.0f;
+				for ( t = 0; t < 4; t++ )
+				{
+					sx = ( t & 1 ) ? x1 : x0;
+					sy = ( t & 2 ) ? y1 : y0;
+					if ( *SUPER_CLUSTER( sx, sy ) < 0 ) {
+						continue;
+					}
+
+					/* a corner on a differently facing surface can't be used, trace this luxel instead */
+					if ( DotProduct( normal, SUPER_NORMAL( sx, sy ) ) < 0.99f ) {
+						totalWeight = 0.0f;
+						break;
+					}
+
+					weight = ( x1 > x0 ? ( ( t & 1 ) ? (float) ( x - x0 ) / ( x1 - x0 ) : (float) ( x1 - x ) / ( x1 - x0 ) ) : 1.0f ) *
+							 ( y1 > y0 ? ( ( t & 2 ) ? (float) ( y - y0 ) / ( y1 - y0 ) : (float) ( y1 - y ) / ( y1 - y0 ) ) : 1.0f );
+					floodLightAmount += floodAmounts[ sy * lm->sw + sx ] * weight;
+					totalWeight += weight;
+				}
+
+				if ( totalWeight > 0.0f ) {
+					floodLightAmount /= totalWeight;
+				}
+				else
+				{
+					/* copy to trace */
+					trace.cluster = *cluster;
+					VectorCopy( origin, trace.origin );
+					VectorCopy( normal, trace.normal );
+
+					/* get floodlight */
+					floodLightAmount = FloodLightForSample( &trace, lmFloodLightDistance, lmFloodLightLowQuality ) * lmFloodLightIntensity;
+				}
+
+				/* add floodlight */
+				floodlight[0] += lmFloodLightRGB[0] * floodLightAmount;
+				floodlight[1] += lmFloodLightRGB[1] * floodLightAmount;
+				floodlight[2] += lmFloodLightRGB[2] * floodLightAmount;
+				floodlight[3] += floodlightDirectionScale;
+			}
+		}
+
+		free( floodAmounts );
+	}
+
 	/* testing no filtering */
 	return;
 
@@ -4426,6 +4745,11 @@ void FloodlightIlluminateLightmap( rawLightmap_t *lm ){
 	float brightness;
 	int x, y, lightmapNum;
 
+	/* no floodlight pass touched this lightmap */
+	if ( lm->superFloodLight == NULL ) {
+		return;
+	}
+
 	/* walk lightmaps */
 	for ( lightmapNum = 0; lightmapNum < MAX_LIGHTMAPS; lightmapNum++ )
 	{
@@ -413,12 +413,11 @@ void FinishRawLightmap( rawLightmap_t *lm ){
 	}
 	memset( lm->superNormals, 0, size );
 
-	/* allocate floodlight map storage */
-	size = lm->sw * lm->sh * SUPER_FLOODLIGHT_SIZE * sizeof( float );
-	if ( lm->superFloodLight == NULL ) {
-		lm->superFloodLight = safe_malloc( size );
+	/* floodlight map storage is allocated by the floodlight pass on first use */
+	if ( lm->superFloodLight != NULL ) {
+		size = lm->sw * lm->sh * SUPER_FLOODLIGHT_SIZE * sizeof( float );
+		memset( lm->superFloodLight, 0, size );
 	}
-	memset( lm->superFloodLight, 0, size );
 
 	/* allocate cluster map storage */
 	size = lm->sw * lm->sh * sizeof( int );
@@ -1388,12 +1387,14 @@ void StitchSurfaceLightmaps( void ){
 #define SOLID_EPSILON       0.0625
 #define LUXEL_TOLERANCE     0.0025
 #define LUXEL_COLOR_FRAC    0.001302083 /* 1 / 3 / 256 */
+#define LUXEL_COMPARE_BLOCK 256
 
 static qboolean CompareBSPLuxels( rawLightmap_t *a, int aNum, rawLightmap_t *b, int bNum ){
-	rawLightmap_t   *lm;
-	int x, y;
+	int i, numLuxels, first, count, outlier;
 	double delta, total, rd, gd, bd;
-	float           *aLuxel, *bLuxel;
+	const float     *aLuxel, *bLuxel;
+	float rDelta[ LUXEL_COMPARE_BLOCK ], gDelta[ LUXEL_COMPARE_BLOCK ], bDelta[ LUXEL_COMPARE_BLOCK ];
+	int used[ LUXEL_COMPARE_BLOCK ];
 
 
 	/* styled lightmaps will never be collapsed to non-styled lightmaps when there is _minlight */
@@ -1431,42 +1432,51 @@ static qboolean CompareBSPLuxels( rawLightmap_t *a, int aNum, rawLightmap_t *b,
 		return qfalse;
 	}
 
-	/* compare luxels */
+	/* compare luxels (both lightmaps have the same size, so walk them as flat arrays in row order) a block at a time:
+	   the first pass over a block has no branches, so the compiler can vectorise it, and the running tolerance test
+	   then scans its results in the original order, so the outcome is the same as testing luxel by luxel */
 	delta = 0.0;
 	total = 0.0;
-	for ( y = 0; y < a->h; y++ )
+	numLuxels = a->w * a->h;
+	for ( first = 0; first < numLuxels; first += LUXEL_COMPARE_BLOCK )
 	{
-		for ( x = 0; x < a->w; x++ )
+		count = ( numLuxels - first < LUXEL_COMPARE_BLOCK ) ? numLuxels - first : LUXEL_COMPARE_BLOCK;
+		aLuxel = a->bspLuxels[ aNum ] + first * BSP_LUXEL_SIZE;
+		bLuxel = b->bspLuxels[ bNum ] + first * BSP_LUXEL_SIZE;
+
+		/* get deltas, ignoring unused luxels */
+		outlier = 0;
+		for ( i = 0; i < count; i++ )
+		{
+			rDelta[ i ] = fabsf( aLuxel[ i * BSP_LUXEL_SIZE + 0 ] - bLuxel[ i * BSP_LUXEL_SIZE + 0 ] );
+			gDelta[ i ] = fabsf( aLuxel[ i * BSP_LUXEL_SIZE + 1 ] - bLuxel[ i * BSP_LUXEL_SIZE + 1 ] );
+			bDelta[ i ] = fabsf( aLuxel[ i * BSP_LUXEL_SIZE + 2 ] - bLuxel[ i * BSP_LUXEL_SIZE + 2 ] );
+			used[ i ] = !( aLuxel[ i * BSP_LUXEL_SIZE ] < 0 ) & !( bLuxel[ i * BSP_LUXEL_SIZE ] < 0 );
+
+			/* 2003-09-27: compare individual luxels */
+			outlier |= used[ i ] & ( ( rDelta[ i ] > 3.0f ) | ( gDelta[ i ] > 3.0f ) | ( bDelta[ i ] > 3.0f ) );
+		}
+		if ( outlier ) {
+			return qfalse;
+		}
+
+		for ( i = 0; i < count; i++ )
 		{
 			/* increment total */
 			total += 1.0;
 
-			/* get luxels */
-			lm = a; aLuxel = BSP_LUXEL( aNum, x, y );
-			lm = b; bLuxel = BSP_LUXEL( bNum, x, y );
-
 			/* ignore unused luxels */
-			if ( aLuxel[ 0 ] < 0 || bLuxel[ 0 ] < 0 ) {
+			if ( !used[ i ] ) {
 				continue;
 			}
 
-			/* get deltas */
-			rd = fabs( aLuxel[ 0 ] - bLuxel[ 0 ] );
-			gd = fabs( aLuxel[ 1 ] - bLuxel[ 1 ] );
-			bd = fabs( aLuxel[ 2 ] - bLuxel[ 2 ] );
-
-			/* 2003-09-27: compare individual luxels */
-			if ( rd > 3.0 || gd > 3.0 || bd > 3.0 ) {
-				return qfalse;
-			}
-
 			/* compare (fixme: take into account perceptual differences) */
-			delta += rd * LUXEL_COLOR_FRAC;
-			delta += gd * LUXEL_COLOR_FRAC;
-			delta += bd * LUXEL_COLOR_FRAC;
+			delta += rDelta[ i ] * LUXEL_COLOR_FRAC;
+			delta += gDelta[ i ] * LUXEL_COLOR_FRAC;
+			delta += bDelta[ i ] * LUXEL_COLOR_FRAC;
 
 			/* is the change too high? */
-			if ( total > 0.0 && ( ( delta / total ) > LUXEL_TOLERANCE ) ) {
+			if ( ( delta / total ) > LUXEL_TOLERANCE ) {
 				return qfalse;
 			}
 		}
@@ -1484,8 +1494,7 @@ static qboolean CompareBSPLuxels( rawLightmap_t *a, int aNum, rawLightmap_t *b,
  */
 
 static qboolean MergeBSPLuxels( rawLightmap_t *a, int aNum, rawLightmap_t *b, int bNum ){
-	rawLightmap_t   *lm;
-	int x, y;
+	int i, numLuxels;
 	float luxel[ 3 ], *aLuxel, *bLuxel;
 
 
@@ -1516,35 +1525,31 @@ static qboolean MergeBSPLuxels( rawLightmap_t *a, int aNum, rawLightmap_t *b, in
 		return qfalse;
 	}
 
-	/* merge luxels */
-	for ( y = 0; y < a->h; y++ )
+	/* merge luxels (same size, so walk them as flat arrays) */
+	numLuxels = a->w * a->h;
+	aLuxel = a->bspLuxels[ aNum ];
+	bLuxel = b->bspLuxels[ bNum ];
+	for ( i = 0; i < numLuxels; i++, aLuxel += BSP_LUXEL_SIZE, bLuxel += BSP_LUXEL_SIZE )
 	{
-		for ( x = 0; x < a->w; x++ )
+		/* handle occlusion mismatch */
+		if ( aLuxel[ 0 ] < 0.0f ) {
+			VectorCopy( bLuxel, aLuxel );
+		}
+		else if ( bLuxel[ 0 ] < 0.0f ) {
+			VectorCopy( aLuxel, bLuxel );
+		}
+		else
 		{
-			/* get luxels */
-			lm = a; aLuxel = BSP_LUXEL( aNum, x, y );
-			lm = b; bLuxel = BSP_LUXEL( bNum, x, y );
-
-			/* handle occlusion mismatch */
-			if ( aLuxel[ 0 ] < 0.0f ) {
-				VectorCopy( bLuxel, aLuxel );
-			}
-			else if ( bLuxel[ 0 ] < 0.0f ) {
-				VectorCopy( aLuxel, bLuxel );
-			}
-			else
-			{
-				/* average */
-				VectorAdd( aLuxel, bLuxel, luxel );
-				VectorScale( luxel, 0.5f, luxel );
+			/* average */
+			VectorAdd( aLuxel, bLuxel, luxel );
+			VectorScale( luxel, 0.5f, luxel );
 
-				/* debugging code */
-				//%	luxel[ 2 ] += 64.0f;
+			/* debugging code */
+			//%	luxel[ 2 ] += 64.0f;
 
-				/* copy to both */
-				VectorCopy( luxel, aLuxel );
-				VectorCopy( luxel, bLuxel );
-			}
+			/* copy to both */
+			VectorCopy( luxel, aLuxel );
+			VectorCopy( luxel, bLuxel );
 		}
 	}
 
@@ -2447,12 +2452,43 @@ void FillOutLightmap( outLightmap_t *olm ){
 
 
 
+/*
+   FreeRawLightmapSuperLuxels()
+   frees a raw lightmap's supersampled buffers once they have been averaged into the bsp luxels
+ */
+
+static void FreeRawLightmapSuperLuxels( rawLightmap_t *lm ){
+	int lightmapNum;
+
+
+	for ( lightmapNum = 0; lightmapNum < MAX_LIGHTMAPS; lightmapNum++ )
+	{
+		free( lm->superLuxels[ lightmapNum ] );
+		lm->superLuxels[ lightmapNum ] = NULL;
+	}
+	free( lm->superFlags );
+	lm->superFlags = NULL;
+	free( lm->superOrigins );
+	lm->superOrigins = NULL;
+	free( lm->superNormals );
+	lm->superNormals = NULL;
+	free( lm->superClusters );
+	lm->superClusters = NULL;
+	free( lm->superDeluxels );
+	lm->superDeluxels = NULL;
+	free( lm->superFloodLight );
+	lm->superFloodLight = NULL;
+}
+
+
+
 /*
    StoreSurfaceLightmaps()
    stores the surface lightmaps into the bsp as byte rgb triplets
+   lastPass is set for the final store, after which no pass reads the supersampled luxels again
  */
 
-void StoreSurfaceLightmaps( qboolean fastLightmapSearch, qboolean storeForReal ){
+void StoreSurfaceLightmaps( qboolean fastLightmapSearch, qboolean storeForReal, qboolean lastPass ){
 	int i, j, k, x, y, lx, ly, sx, sy, *cluster, mappedSamples;
 	int style, size, lightmapNum, lightmapNum2;
 	float               *normal, *luxel, *bspLuxel, *bspLuxel2, *radLuxel, samples, occludedSamples;
@@ -2472,11 +2508,15 @@ void StoreSurfaceLightmaps( qboolean fastLightmapSearch, qboolean storeForReal )
 	char lightmapName[ 128 ];
 	const char          *rgbGenValues[ 256 ];
 	const char          *alphaGenValues[ 256 ];
+	qboolean freeSuperLuxels;
 
 
 	/* note it */
 	Sys_Printf( "--- StoreSurfaceLightmaps ---\n" );
 
+	/* lomem: drop the supersampled buffers as soon as they are averaged down, unless the tangentspace conversion still needs the normals */
+	freeSuperLuxels = ( loMem && lastPass && !( !bouncing && deluxemap && deluxemode == 1 ) );
+
 	/* setup */
 	if ( lmCustomDir ) {
 		strcpy( dirname, lmCustomDir );
@@ -2827,6 +2867,11 @@ void StoreSurfaceLightmaps( qboolean fastLightmapSearch, qboolean storeForReal )
 				}
 			}
 		}
+
+		/* the remaining stages only read the bsp luxels */
+		if ( freeSuperLuxels ) {
+			FreeRawLightmapSuperLuxels( lm );
+		}
 	}
 
 	/* -----------------------------------------------------------------
@@ -2910,6 +2955,12 @@ void StoreSurfaceLightmaps( qboolean fastLightmapSearch, qboolean storeForReal )
 		}
 	}
 
+	/* lomem: free whatever the tangentspace conversion kept alive */
+	if ( loMem && lastPass && !freeSuperLuxels ) {
+		for ( i = 0; i < numRawLightmaps; i++ )
+			FreeRawLightmapSuperLuxels( &rawLightmaps[ i ] );
+	}
+
 	/* -----------------------------------------------------------------
 	   blend lightmaps
 	   ----------------------------------------------------------------- */
@@ -47,6 +47,34 @@ vec_t Random( void ){
 }
 
 
+
+/*
+   SeededRandom()
+   returns a pseudorandom number between 0 and 1 that only depends on its arguments,
+   so threaded passes draw the same numbers no matter which thread handles which item
+ */
+
+static unsigned int HashRandomKey( unsigned int x ){
+	x ^= x >> 16;
+	x *= 0x7feb352dU;
+	x ^= x >> 15;
+	x *= 0x846ca68bU;
+	x ^= x >> 16;
+	return x;
+}
+
+vec_t SeededRandom( unsigned int stream, unsigned int index, unsigned int sample ){
+	unsigned int h;
+
+	h = HashRandomKey( sample + 0x9e3779b9U );
+	h = HashRandomKey( h ^ index );
+	h = HashRandomKey( h ^ stream );
+
+	/* use the top 24 bits so the result is exact in a float */
+	return (vec_t) ( h >> 8 ) * ( 1.0f / 16777216.0f );
+}
+
+
 char *Q_strncpyz( char *dst, const char *src, size_t len ) {
 	if ( len == 0 ) {
 		abort();
@@ -253,6 +253,7 @@
 #define LIGHT_FAST_ACTUAL       ( LIGHT_FAST | LIGHT_FAST_TEMP )
 #define LIGHT_NEGATIVE          1024
 #define LIGHT_UNNORMALIZED      2048    /* vortex: do not normalize _color */
+#define LIGHT_SKY               4096    /* sun created by q3map_skyLight, see -skysamplestep */
 
 #define LIGHT_SUN_DEFAULT       ( LIGHT_ATTEN_ANGLE | LIGHT_GRID | LIGHT_SURFACES )
 #define LIGHT_AREA_DEFAULT      ( LIGHT_ATTEN_ANGLE | LIGHT_ATTEN_DISTANCE | LIGHT_GRID | LIGHT_SURFACES )    /* q3a and wolf are the same */
@@ -305,6 +306,13 @@
 #define SUPER_DIRT( x, y )      ( lm->superNormals + ( ( ( ( y ) * lm->sw ) + ( x ) ) * SUPER_NORMAL_SIZE ) + 3 )   /* stash dirtyness in normal[ 3 ] */
 #define SUPER_FLOODLIGHT( x, y )    ( lm->superFloodLight + ( ( ( ( y ) * lm->sw ) + ( x ) ) * SUPER_FLOODLIGHT_SIZE ) )
 
+/* SeededRandom() streams, keyed by what is being sampled so threaded light output does not depend on scheduling */
+#define RANDOM_SUBSAMPLE        0
+#define RANDOM_LUXEL_DIRT       1
+#define RANDOM_VERTEX_DIRT      2
+#define RANDOM_GRID_NUDGE       3
+#define RANDOM_STREAM( k, n )   ( ( ( unsigned int ) ( n ) << 2 ) | ( k ) )
+
 
 
 /* -------------------------------------------------------------------------------
@@ -1532,6 +1540,7 @@ surfaceInfo_t;
 
 /* main.c */
 vec_t                       Random( void );
+vec_t                       SeededRandom( unsigned int stream, unsigned int index, unsigned int sample );
 char                        *Q_strncpyz( char *dst, const char *src, size_t len );
 char                        *Q_strcat( char *dst, size_t dlen, const char *src );
 char                        *Q_strncat( char *dst, size_t dlen, const char *src, size_t slen );
@@ -1839,7 +1848,7 @@ void                        SmoothNormals( void );
 void                        MapRawLightmap( int num );
 
 void                        SetupDirt();
-float                       DirtForSample( trace_t *trace );
+float                       DirtForSample( trace_t *trace, unsigned int randomStream, unsigned int randomIndex );
 void                        DirtyRawLightmap( int num );
 
 void                        SetupFloodLight();
@@ -1849,6 +1858,8 @@ float                       FloodLightForSample( trace_t *trace, float floodLigh
 void                        FloodLightRawLightmap( int num );
 
 void                        IlluminateRawLightmap( int num );
+void                        SetupRawLightmapOrder( void );
+void                        IlluminateRawLightmapOrdered( int num );
 void                        IlluminateVertexes( int num );
 
 void                        SetupBrushesFlags( unsigned int mask_any, unsigned int test_any, unsigned int mask_all, unsigned int test_all );
@@ -1874,7 +1885,7 @@ int                         ImportLightmapsMain( int argc, char **argv );
 
 void                        SetupSurfaceLightmaps( void );
 void                        StitchSurfaceLightmaps( void );
-void                        StoreSurfaceLightmaps( qboolean fastLightmapSearch, qboolean storeForReal );
+void                        StoreSurfaceLightmaps( qboolean fastLightmapSearch, qboolean storeForReal, qboolean lastPass );
 
 
 /* exportents.c */
@@ -2292,6 +2303,7 @@ Q_EXTERN int superSample Q_ASSIGN( 0 );
 Q_EXTERN int lightSamples Q_ASSIGN( 1 );
 Q_EXTERN qboolean lightRandomSamples Q_ASSIGN( qfalse );
 Q_EXTERN int lightSamplesSearchBoxSize Q_ASSIGN( 1 );
+Q_EXTERN int skySampleStep Q_ASSIGN( 1 );
 Q_EXTERN qboolean filter Q_ASSIGN( qfalse );
 Q_EXTERN qboolean dark Q_ASSIGN( qfalse );
 Q_EXTERN qboolean sunOnly Q_ASSIGN( qfalse );